@@ -1,7 +1,13 @@
 #pragma once
 
+#include "BoundedQueue.hpp"
+
 #include <SFML/Audio.hpp>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
 #include <vector>
 
 class AudioEngine
@@ -84,3 +90,119 @@ private:
     float m_sample_rate = 44100.0f;
     int m_channel_count = 1;
 };
+
+/* Plays audio as it is produced, for live sonification. push() queues a
+ * block of samples, blocking while `depth` blocks are already waiting, so
+ * the producer is held to the pace of playback and the latency stays
+ * bounded. If the producer falls behind, short stretches of silence fill in
+ * until it catches up. After finish() the stream plays out what is queued
+ * and stops. */
+class LiveStream : public sf::SoundStream
+{
+public:
+    LiveStream(float sample_rate, int channel_count, std::size_t depth = 4);
+    ~LiveStream() override;
+
+    // False once finish() was called
+    bool push(const std::vector<float> &samples);
+    void finish() noexcept;
+    // Blocks until everything pushed before finish() has played
+    void wait() const noexcept;
+
+protected:
+    bool onGetData(Chunk &data) override;
+    void onSeek(sf::Time) override {}
+
+private:
+    BoundedQueue<std::vector<std::int16_t>> m_queue;
+    std::vector<std::int16_t> m_playing;
+    std::vector<std::int16_t> m_silence;
+};
+
+/* Writes audio to a file descriptor (stdout for `-o -`) as raw interleaved
+ * PCM in native byte order, a block at a time as it is rendered, for
+ * piping into encoders and analysers. */
+class PcmWriter
+{
+public:
+    enum class Format { S16, F32 };
+
+    // "s16" or "f32"; throws std::runtime_error on anything else
+    static Format parse_format(const std::string &name);
+
+    PcmWriter(int fd, Format format) noexcept : m_fd(fd), m_format(format) {}
+
+    // Throws std::runtime_error if the descriptor stops taking data (e.g. the
+    // reader went away)
+    void write(const std::vector<float> &samples);
+
+private:
+    int m_fd;
+    Format m_format;
+    std::vector<std::int16_t> m_s16; // reused conversion buffer
+};
+
+/* Writes audio to a file through sf::OutputSoundFile (WAV, OGG/Vorbis or
+ * FLAC, by extension) on a thread of its own. Blocks are converted to 16-bit
+ * and handed over through a bounded queue, so a render that hands out
+ * blocks as it goes overlaps with encoding instead of waiting for it, and
+ * only stalls if the encoder falls `depth` blocks behind. */
+class BackgroundEncoder
+{
+public:
+    // Opens `path` for writing; throws std::runtime_error if it cannot
+    BackgroundEncoder(const std::string &path, unsigned int sample_rate,
+                      int channel_count, std::size_t depth = 4);
+    // Finishes if finish() was not called
+    ~BackgroundEncoder();
+
+    BackgroundEncoder(const BackgroundEncoder &)            = delete;
+    BackgroundEncoder &operator=(const BackgroundEncoder &) = delete;
+
+    // Blocks while the queue is full. Throws std::runtime_error once the
+    // encoder has failed.
+    void push(const std::vector<float> &samples);
+    // Waits for everything pushed to be encoded and closes the file. False
+    // if encoding failed or the file does not read back with every sample
+    // pushed (sf::OutputSoundFile does not report I/O errors, so a full
+    // disk only shows up there).
+    bool finish() noexcept;
+
+    std::uint64_t sample_count() const noexcept { return m_pushed; }
+
+private:
+    std::string m_path;
+    sf::OutputSoundFile m_file;
+    BoundedQueue<std::vector<std::int16_t>> m_queue;
+    std::uint64_t m_pushed = 0;
+    std::atomic<bool> m_failed{false};
+    std::thread m_thread;
+};
+
+/* A 32-bit float WAV file created at its final size and mapped writable, so
+ * a render can write its samples straight into the page cache with no
+ * buffer of its own. Files whose data exceeds 4 GiB get an RF64 header. The
+ * whole file is allocated up front, so a full disk fails here rather than
+ * mid-render; the data starts 16-byte aligned and reads as zeros until
+ * written. */
+class WavMapping
+{
+public:
+    // Creates (or truncates) `path` to hold `samples` interleaved samples;
+    // throws std::runtime_error on failure
+    WavMapping(const std::string &path, std::size_t samples, int channel_count,
+               unsigned int sample_rate);
+    ~WavMapping();
+
+    WavMapping(const WavMapping &)            = delete;
+    WavMapping &operator=(const WavMapping &) = delete;
+
+    float *samples() const noexcept { return m_samples; }
+    std::size_t sample_count() const noexcept { return m_count; }
+
+private:
+    void *m_map = nullptr;
+    std::size_t m_size = 0;
+    float *m_samples = nullptr;
+    std::size_t m_count = 0;
+};
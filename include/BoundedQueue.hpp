@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/* Fixed-capacity FIFO between the threads of a pipeline. push() blocks while
+ * the queue is full and pop() while it is empty. close() wakes both sides:
+ * afterwards push() fails at once and pop() drains what is left, so either
+ * end can stop the pipeline without the other blocking forever. */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : m_capacity(std::max<std::size_t>(1, capacity))
+    {
+    }
+
+    // False (dropping `value`) if the queue was closed
+    bool push(T &&value)
+    {
+        std::unique_lock lock(m_mutex);
+        m_not_full.wait(lock, [&] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed)
+            return false;
+        m_items.push_back(std::move(value));
+        lock.unlock();
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    // False once the queue is closed and empty
+    bool pop(T &out)
+    {
+        std::unique_lock lock(m_mutex);
+        m_not_empty.wait(lock, [&] { return m_closed || !m_items.empty(); });
+        if (m_items.empty())
+            return false;
+        out = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    // Non-blocking push: false (leaving `value` alone) if the queue is full
+    // or closed
+    bool try_push(T &&value)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_closed || m_items.size() >= m_capacity)
+                return false;
+            m_items.push_back(std::move(value));
+        }
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    // Non-blocking pop: false if the queue is empty
+    bool try_pop(T &out)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_items.empty())
+                return false;
+            out = std::move(m_items.front());
+            m_items.pop_front();
+        }
+        m_not_full.notify_one();
+        return true;
+    }
+
+    bool closed() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_closed;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_closed = true;
+        }
+        m_not_full.notify_all();
+        m_not_empty.notify_all();
+    }
+
+private:
+    std::size_t m_capacity;
+    std::deque<T> m_items;
+    bool m_closed = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+};
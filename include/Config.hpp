@@ -1,9 +1,13 @@
 #pragma once
 
+#include "ScriptGuard.hpp"
 #include "SonifyEngine.hpp"
+#include "Voices.hpp"
 
 #include <SFML/Graphics.hpp>
 #include <cstdint>
+#include <optional>
+#include <string>
 
 struct CursorOpts
 {
@@ -74,9 +78,14 @@ struct Config
     OscilloscopeOpts oscilloscope;
     float amplitude             = 1.0f;
     sonify::Direction direction = sonify::Direction::LEFT_TO_RIGHT;
+    float scan_angle            = 0.f; // degrees, for Direction::ANGLE
     sf::ContextSettings window;
     float image_rotation = 0.f;
     bool loop    = false;
     bool verbose = false;
     unsigned int fps_limit = 60;
+    int sonify_threads     = 1; // Lua states rendering a custom sonify_func
+    ScriptLimits script_limits;
+    std::optional<sonify::VoiceParams> voice; // native voice instead of sonify_func
+    std::string sonify_expr; // compiled expression instead of sonify_func
 };
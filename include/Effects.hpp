@@ -1,7 +1,11 @@
 #pragma once
 
+#include <memory>
+#include <span>
 #include <vector>
 
+struct AudioEffectsOpts;
+
 class Effects
 {
 public:
@@ -27,3 +31,26 @@ public:
                                          float drive = 0.5f,
                                          float mix   = 1.0f);
 };
+
+/* The built-in effects in the order they are applied after sonification:
+ * gain (amplitude times the effects gain), distortion, reverb and delay,
+ * each skipped at mix 0. Filter and delay-line state carries over from one
+ * process() call to the next, so audio processed a block at a time as it is
+ * rendered comes out exactly as the whole buffer processed at once. */
+class EffectChain
+{
+public:
+    EffectChain(const AudioEffectsOpts &opts, float amplitude,
+                float sample_rate);
+    ~EffectChain();
+
+    EffectChain(const EffectChain &)            = delete;
+    EffectChain &operator=(const EffectChain &) = delete;
+
+    void process(std::vector<float> &block) noexcept;
+    void process(std::span<float> block) noexcept;
+
+private:
+    struct State;
+    std::unique_ptr<State> m_state;
+};
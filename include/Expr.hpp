@@ -0,0 +1,53 @@
+#pragma once
+
+#include "SonifyEngine.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sonify
+{
+
+/* A sonify function written as a math expression, e.g.
+ *
+ *     sin(phase) * b + 0.2 * noise()
+ *
+ * The source is parsed once into register bytecode: one instruction per
+ * node, constants folded, each instruction marked uniform (depends on strip
+ * fields only) or varying (depends on the sample). Per strip, uniform
+ * instructions run once; varying ones run over blocks of BLOCK samples with
+ * a tight loop per instruction, so the evaluation does no per-sample
+ * dispatch and most kernels vectorize.
+ *
+ * Expressions separated by ';' give the channels in order; the last one is
+ * repeated for any remaining channels. Expressions are stateless, so one
+ * compiled program is shared by every render thread. */
+class Expr
+{
+public:
+    static constexpr int BLOCK = 64;
+
+    // Throws std::runtime_error naming the column of the first error.
+    explicit Expr(const std::string &source);
+
+    inline const std::string &source() const noexcept { return m_source; }
+
+    // Number of ';'-separated expressions.
+    int channels() const noexcept;
+
+    // Appends ctx.n_samples frames to `out`, like any SonifyFunc. Safe to
+    // call concurrently.
+    void eval(const SonifyContext &ctx, std::vector<float> &out) const;
+
+    // The expression as a sonify function; it shares the compiled program.
+    SonifyFunc func() const;
+
+    struct Program;
+
+private:
+    std::string m_source;
+    std::shared_ptr<const Program> m_program;
+};
+
+} // namespace sonify
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace sonify
+{
+
+/* The functions below are branch-free and make no libm calls (std::floor and
+ * std::sin are library calls without SSE4.1 or -ffast-math), so loops over
+ * them vectorize. Arguments must stay within +-2^31. */
+
+// floor(x)
+inline float
+fast_floor(float x) noexcept
+{
+    const float f = static_cast<float>(static_cast<int>(x));
+    // Truncation rounded up iff x - f is negative (and not -0)
+    const std::int32_t d = std::bit_cast<std::int32_t>(x - f);
+    return f - static_cast<float>((d < 0) & (d != INT32_MIN));
+}
+
+/* sin(2 pi x), x in turns, for x > -256; max error about 1e-3 */
+inline float
+fast_sin_turns(float x) noexcept
+{
+    // Truncation is floor for positive values; the offset costs 2^-16 turns
+    // of resolution
+    x -= static_cast<float>(static_cast<int>(x + 256.5f)) - 256.0f; // [-0.5, 0.5)
+    const float y = 8.0f * x - 16.0f * x * std::abs(x);
+    return 0.225f * (y * std::abs(y) - y) + y;
+}
+
+/* sin(2 pi x), x in turns; max error about 4e-6. Forced inline: as a call
+ * it would keep the caller's loop from vectorizing. */
+[[gnu::always_inline]] inline float
+sin_turns(float x) noexcept
+{
+    float r = x - static_cast<float>(static_cast<int>(x)); // (-1, 1)
+    r -= static_cast<float>(static_cast<int>(2.0f * r));   // [-0.5, 0.5]
+    // Fold |r| into [0, 1/4] (sin(pi - a) = sin(a)), then a degree 9 Taylor
+    // polynomial
+    const float a  = 0.25f - std::abs(std::abs(r) - 0.25f);
+    const float z  = 6.2831853f * a;
+    const float z2 = z * z;
+    const float p  = z * (1.0f + z2 * (-1.0f / 6.0f + z2 * (1.0f / 120.0f
+                     + z2 * (-1.0f / 5040.0f + z2 * (1.0f / 362880.0f)))));
+    return std::copysign(p, r);
+}
+
+} // namespace sonify
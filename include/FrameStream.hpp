@@ -0,0 +1,56 @@
+#pragma once
+
+#include "SonifyEngine.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* Raw frames read from stdin or a named pipe, for live sonification.
+ *
+ * Frames are headerless 8-bit pixels of a size and layout declared up front
+ * (gray, rgb or rgba, rows top to bottom, no padding), back to back. Each
+ * one is read in full into a single reused byte buffer and normalised
+ * straight into the RawImage handed in, whose storage the engine recycles
+ * from spent frames, so the stream allocates nothing per frame. Reads block
+ * until the producer writes, which is what paces a live stream. */
+class FrameStream
+{
+public:
+    struct Format
+    {
+        int width    = 0;
+        int height   = 0;
+        int channels = 4;
+
+        // "WxH" or "WxH:FORMAT", FORMAT one of gray, rgb, rgba (default).
+        // Throws std::runtime_error on anything else.
+        static Format parse(const std::string &spec);
+
+        std::size_t frame_bytes() const noexcept
+        {
+            return static_cast<std::size_t>(width) * height * channels;
+        }
+    };
+
+    // `path` "-" reads stdin; a FIFO blocks here until a writer opens it.
+    // Throws std::runtime_error if the file cannot be opened.
+    FrameStream(const std::string &path, const Format &format);
+    ~FrameStream();
+
+    FrameStream(const FrameStream &)            = delete;
+    FrameStream &operator=(const FrameStream &) = delete;
+
+    const Format &format() const noexcept { return m_format; }
+
+    // Reads the next frame into `img`. False at end of input; throws
+    // std::runtime_error on a read error or a frame cut short.
+    bool read(sonify::RawImage &img);
+
+private:
+    Format m_format;
+    std::string m_path;
+    int m_fd       = -1;
+    bool m_owns_fd = false;
+    std::unique_ptr<std::uint8_t[]> m_bytes;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "FastMath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace sonify
+{
+
+struct GranularOpts
+{
+    int   tile      = 16;    // tile edge in pixels
+    float density   = 40.0f; // grains per second from a tile of value 1
+    float grain_min = 0.01f; // grain length in seconds for a grey tile
+    float grain_max = 0.12f; // grain length in seconds for a saturated tile
+    float jitter    = 0.5f;  // onset randomization, fraction of the spacing
+};
+
+/* One Hann-windowed sine grain */
+struct Grain
+{
+    std::int64_t start; // first output frame
+    int   length;       // frames
+    float phase;        // start phase in turns, [0, 1)
+    float inc;          // phase increment per frame in turns, [0, 0.5]
+    float amp;          // mono gain
+    float pan_l, pan_r; // equal-power stereo gains
+};
+
+/* Grains of one render, stored flat and sorted by start so that any range of
+ * output frames can be mixed independently (and so in parallel). Capacity is
+ * reserved up front from the scheduled grain count; nothing is allocated
+ * while mixing except each caller's scratch buffer, once. */
+class GrainPool
+{
+public:
+    void reset(std::size_t count)
+    {
+        m_grains.clear();
+        m_grains.resize(count);
+        m_max_length = 0;
+    }
+
+    inline std::size_t size() const noexcept { return m_grains.size(); }
+    inline Grain &operator[](std::size_t i) noexcept { return m_grains[i]; }
+
+    // Call once every grain is filled in, before mix().
+    void finalize()
+    {
+        std::sort(m_grains.begin(), m_grains.end(),
+                  [](const Grain &a, const Grain &b) { return a.start < b.start; });
+        m_max_length = 0;
+        for (const Grain &g : m_grains)
+            m_max_length = std::max(m_max_length, g.length);
+    }
+
+    // Adds every grain overlapping frames [begin, end) to `out`, which holds
+    // those frames interleaved with `channels` channels (1 = mono, otherwise
+    // even channels left and odd channels right).
+    void mix(std::int64_t begin, std::int64_t end, float *out, int channels,
+             std::vector<float> &scratch) const
+    {
+        scratch.resize(static_cast<std::size_t>(std::max(m_max_length, 1)));
+        auto it = std::lower_bound(m_grains.begin(), m_grains.end(),
+                                   begin - m_max_length,
+                                   [](const Grain &g, std::int64_t f) { return g.start < f; });
+        for (; it != m_grains.end() && it->start < end; ++it)
+        {
+            const Grain &g = *it;
+            const int k0 = static_cast<int>(std::max<std::int64_t>(0, begin - g.start));
+            const int k1 = static_cast<int>(std::min<std::int64_t>(g.length, end - g.start));
+            if (k0 >= k1)
+                continue;
+
+            // Grain samples first. Loops run in fixed blocks of LANES so GCC
+            // vectorizes them at -O2 too (its default cost model skips loops
+            // that need a runtime trip count); fields are copied out so the
+            // stores to `s` cannot alias them.
+            float *__restrict s  = scratch.data();
+            const float inv_len = 1.0f / static_cast<float>(g.length);
+            const float phase   = g.phase, inc = g.inc;
+            const int n         = k1 - k0;
+            const int n_blocked = n - n % LANES;
+            auto sample = [&](int k)
+            {
+                const float kf = static_cast<float>(k + k0);
+                const float w  = fast_sin_turns(0.5f * (kf + 0.5f) * inv_len);
+                return w * w * fast_sin_turns(phase + kf * inc);
+            };
+            for (int k = 0; k < n_blocked; k += LANES)
+                for (int j = 0; j < LANES; ++j)
+                    s[k + j] = sample(k + j);
+            for (int k = n_blocked; k < n; ++k)
+                s[k] = sample(k);
+
+            float *__restrict o = out + (g.start + k0 - begin) * channels;
+            if (channels == 1)
+            {
+                const float a = g.amp;
+                for (int k = 0; k < n_blocked; k += LANES)
+                    for (int j = 0; j < LANES; ++j)
+                        o[k + j] += a * s[k + j];
+                for (int k = n_blocked; k < n; ++k)
+                    o[k] += a * s[k];
+            }
+            else if (channels == 2)
+            {
+                const float l = g.amp * g.pan_l, r = g.amp * g.pan_r;
+                for (int k = 0; k < n_blocked; k += LANES)
+                    for (int j = 0; j < LANES; ++j)
+                    {
+                        o[2 * (k + j)]     += l * s[k + j];
+                        o[2 * (k + j) + 1] += r * s[k + j];
+                    }
+                for (int k = n_blocked; k < n; ++k)
+                {
+                    o[2 * k]     += l * s[k];
+                    o[2 * k + 1] += r * s[k];
+                }
+            }
+            else
+            {
+                const float l = g.amp * g.pan_l, r = g.amp * g.pan_r;
+                for (int k = 0; k < n; ++k)
+                    for (int ch = 0; ch < channels; ++ch)
+                        o[k * channels + ch] += s[k] * ((ch & 1) ? r : l);
+            }
+        }
+    }
+
+private:
+    static constexpr int LANES = 8;
+
+    std::vector<Grain> m_grains;
+    int m_max_length = 0;
+};
+
+} // namespace sonify
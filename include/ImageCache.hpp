@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SonifyEngine.hpp"
+#include "utils.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+/* Content-addressed cache of decoded images, in $XDG_CACHE_HOME/sonopix
+ * (~/.cache/sonopix by default).
+ *
+ * Entries are keyed on a hash of the image file's bytes and of the options
+ * that decide its analysis size, so renaming or touching a file still hits
+ * and editing it misses. `<key>.rgba` holds the decoded RGBA8 pixels behind
+ * a fixed header and is mapped straight back in on a hit; `<key>.polar`
+ * holds the engine's whole-image polar reductions. Entries are written to a
+ * temporary file and renamed into place, so concurrent runs never see a
+ * partial one. A hit refreshes the entry's modification time, and every
+ * write prunes the least recently used entries until the directory fits in
+ * its size cap; the directory can be deleted at any time. */
+class ImageCache
+{
+public:
+    // Offset of the pixels in a mapped `.rgba` entry
+    static constexpr std::size_t PIXELS_OFFSET = 32;
+    static constexpr std::uintmax_t DEFAULT_MAX_BYTES = std::uintmax_t(1) << 30;
+
+    explicit ImageCache(std::filesystem::path dir  = default_dir(),
+                        std::uintmax_t max_bytes = DEFAULT_MAX_BYTES);
+
+    static std::filesystem::path default_dir();
+
+    static std::uint64_t key(const std::uint8_t *data, std::size_t size,
+                             const sonify::ScanShape &shape) noexcept;
+
+    // Mapping of the cached pixels of `key` (at PIXELS_OFFSET), their size
+    // and the size of the image they were decoded from, or nullptr on a
+    // miss or a damaged entry.
+    std::unique_ptr<MappedFile> find_pixels(std::uint64_t key, unsigned &w,
+                                            unsigned &h, unsigned &source_w,
+                                            unsigned &source_h) const noexcept;
+    void store_pixels(std::uint64_t key, unsigned w, unsigned h,
+                      unsigned source_w, unsigned source_h,
+                      const std::uint8_t *rgba) const noexcept;
+
+    // Bytes of SonifyEngine::save_polar() stored for `key`, or empty.
+    std::vector<std::uint8_t> find_polar(std::uint64_t key) const noexcept;
+    void store_polar(std::uint64_t key,
+                     const std::vector<std::uint8_t> &bytes) const noexcept;
+
+private:
+    std::filesystem::path m_dir;
+    std::uintmax_t m_max_bytes;
+
+    std::filesystem::path entry(std::uint64_t key, const char *ext) const;
+    bool write_entry(const std::filesystem::path &path, const void *header,
+                     std::size_t header_size, const void *data,
+                     std::size_t size) const noexcept;
+    void prune() const noexcept;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ScriptGuard.hpp"
+#include "SonifyEngine.hpp"
+
+#include <lua.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Calls the function stored under the registry key "sonopix_sonify_func" of
+// `L` with a reused context table and appends its n_samples * channel_count
+// results to `out` (silence on error). Throws std::runtime_error, naming the
+// strip, if the call is aborted by the state's ScriptGuard.
+void call_lua_sonify_func(lua_State *L, const sonify::SonifyContext &ctx,
+                          std::vector<float> &out);
+
+/* Pool of independent Lua states, each running the same script, so that a
+ * custom `sonify_func` renders off the main state, which the event loop
+ * keeps using, and can be called from several render threads at once.
+ *
+ * Worker states get a reduced `sonopix` table: `opts` is a plain table (only
+ * `sonify_func` is read back), `pixel_brightness` reads the engine's image,
+ * and every other API function is a no-op so that top-level calls such as
+ * `sonopix.open_file()` or `sonopix.sonify()` have no side effects. */
+class LuaStatePool
+{
+public:
+    LuaStatePool() = default;
+    ~LuaStatePool();
+
+    LuaStatePool(const LuaStatePool &)            = delete;
+    LuaStatePool &operator=(const LuaStatePool &) = delete;
+
+    // (Re)creates `count` states and runs `script_file` in each. Throws
+    // std::runtime_error if the script fails in any of them.
+    void load(const std::string &script_file, int count,
+              const sonify::SonifyEngine *engine);
+    void clear() noexcept;
+
+    inline std::size_t size() const noexcept { return m_states.size(); }
+    inline bool matches(const std::string &script_file,
+                        int count) const noexcept
+    {
+        return script_file == m_script_file
+               && static_cast<int>(m_states.size()) == count;
+    }
+
+    // Applies the limits and render deadline of `guard` to every state.
+    void share_budget(const ScriptGuard &guard) noexcept;
+
+    // One SonifyFunc per state, or an empty vector if any state did not
+    // define `sonopix.opts.sonify_func`.
+    std::vector<sonify::SonifyFunc> sonify_funcs() const;
+
+private:
+    std::vector<lua_State *> m_states;
+    std::vector<std::unique_ptr<ScriptGuard>> m_guards; // one per state
+    std::string m_script_file;
+};
@@ -2,7 +2,12 @@
 
 #include "AudioEngine.hpp"
 #include "Config.hpp"
+#include "Effects.hpp"
+#include "FrameStream.hpp"
+#include "ImageCache.hpp"
+#include "LuaStatePool.hpp"
 #include "SonifyEngine.hpp"
+#include "Traversal.hpp"
 #include "thirdparty/argparse.hpp"
 
 #include <SFML/Graphics.hpp>
@@ -12,11 +17,14 @@
 #include <SFML/Window.hpp>
 #include <SFML/Window/ContextSettings.hpp>
 #include <atomic>
+#include <functional>
 #include <future>
 #include <lua.hpp>
 #include <memory>
+#include <optional>
 #include <string>
 #include <thread>
+#include <unistd.h>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -49,6 +57,17 @@ public:
         return m_config.direction;
     }
 
+    inline void set_scan_angle(float degrees) noexcept
+    {
+        m_config.scan_angle = degrees;
+        m_sonifier->set_scan_angle(degrees);
+    }
+
+    inline float scan_angle() const noexcept
+    {
+        return m_config.scan_angle;
+    }
+
     inline void set_amplitude(float amp) noexcept
     {
         m_config.amplitude = amp;
@@ -160,7 +179,47 @@ public:
         return m_config.fps_limit;
     }
 
-    void main_loop();
+    inline void set_sonify_threads(int n) noexcept
+    {
+        m_config.sonify_threads = std::max(1, n);
+    }
+
+    inline int sonify_threads() const noexcept
+    {
+        return m_config.sonify_threads;
+    }
+
+    inline void set_script_limits(const ScriptLimits &limits) noexcept
+    {
+        m_config.script_limits = limits;
+    }
+
+    inline const ScriptLimits &script_limits() const noexcept
+    {
+        return m_config.script_limits;
+    }
+
+    // Plays a native voice instead of sonify_func; nullopt restores the
+    // built-in sine.
+    void set_voice(const std::optional<sonify::VoiceParams> &voice) noexcept;
+
+    inline const std::optional<sonify::VoiceParams> &voice() const noexcept
+    {
+        return m_config.voice;
+    }
+
+    // Plays a compiled expression (see sonify::Expr) instead of
+    // sonify_func; an empty string restores the built-in sine. Throws
+    // std::runtime_error if the expression does not compile, leaving the
+    // current function in place.
+    void set_sonify_expr(const std::string &source);
+
+    inline const std::string &sonify_expr() const noexcept
+    {
+        return m_config.sonify_expr;
+    }
+
+    int main_loop();
     void read_args(const argparse::ArgumentParser &parser);
     void set_cursor_width(float w) noexcept;
     void set_cursor_color(const std::string &color_str) noexcept;
@@ -168,7 +227,54 @@ public:
     bool save_audio(const std::string &filename) noexcept;
 
 private:
-    void load_image(sf::Image &img, const std::string &filename);
+    // RGBA8 pixels of a decoded image file. WebP files are decoded into
+    // `rgba`, every other format is loaded by SFML into `image`, and images
+    // found in the ImageCache stay in its mapping.
+    struct DecodedImage
+    {
+        sf::Vector2u size;
+        sf::Vector2u source_size; // of the file's pixels, before any reduction
+        sf::Image image;
+        std::unique_ptr<std::uint8_t[]> rgba;
+        std::unique_ptr<MappedFile> cached;
+
+        const std::uint8_t *pixels() const noexcept
+        {
+            if (cached)
+                return cached->data() + ImageCache::PIXELS_OFFSET;
+            return rgba ? rgba.get() : image.getPixelsPtr();
+        }
+    };
+
+    // An image file decoded and normalised by the loader thread
+    struct OpenedImage
+    {
+        std::string filename;
+        std::string path; // filename with ~ expanded
+        DecodedImage image;
+        std::vector<float> data; // normalised RGBA, as RawImage stores it
+        std::optional<std::uint64_t> cache_key;
+        std::vector<std::uint8_t> polar; // cached polar reductions, if any
+        int frame_count = 1; // > 1 for animated WebP
+    };
+
+    static DecodedImage load_image(const std::string &filename,
+                                   const MappedFile &file,
+                                   const sonify::ScanShape &shape);
+    static OpenedImage decode_file(const std::string &filename,
+                                   const sonify::ScanShape &shape,
+                                   const ImageCache *cache, bool store);
+    void cache_polar() noexcept;
+    void sonify_sequence(const std::string &path, int frame_count,
+                         sf::Vector2u size);
+    int run_stream() noexcept;
+    void claim_stdout() noexcept;
+    void render_pcm(const std::function<void()> &render, EffectChain &effects);
+    void render_encoded(const std::function<void()> &render, EffectChain &effects);
+    void render_mapped(const std::function<void()> &render, EffectChain &effects,
+                       bool direct);
+    void finish_open_file() noexcept;
+    void show_image(OpenedImage &&opened);
     /* Interactive methods */
     void open_file(const std::string &filename);
     void play() noexcept;
@@ -176,14 +282,32 @@ private:
     void stop() noexcept;
     void toggle_pause() noexcept;
     bool sonify();
+    bool cancel_sonify() noexcept;
+
+    // State of the sonify job in flight. `phase` is "traversing" or
+    // "rendering", or nullptr when idle; `eta` is in seconds, or negative
+    // when unknown.
+    struct SonifyStatus
+    {
+        const char *phase = nullptr;
+        float progress    = 0.0f;
+        float eta         = -1.0f;
+    };
+    SonifyStatus sonify_status() const noexcept;
 
     // Lua integration
     void init_lua(const std::string &script_file);
     void init_lua_sonopix() noexcept;
     void init_lua_sonopix_opts() noexcept;
-    void collect_traversal_pixels() noexcept;
+    bool begin_traversal() noexcept;
+    bool step_traversal(sf::Time budget) noexcept;
+    void start_render() noexcept;
+    void report_sonify_progress() noexcept;
+    void finish_sonify() noexcept;
+    void fail_sonify(const std::string &error) noexcept;
+    void prepare_worker_states();
     void apply_audio_process_func(std::vector<float> &audio_data,
-                                  float sample_rate) noexcept;
+                                  float sample_rate);
 
     /* Events */
     void handle_events() noexcept;
@@ -218,7 +342,8 @@ private:
     void create_window() noexcept;
     void start_script_watcher(const std::string &path) noexcept;
     void stop_script_watcher() noexcept;
-    void fire_event(const std::string &name) noexcept;
+    void fire_event(const std::string &name,
+                    const std::vector<std::string> &args = {}) noexcept;
     void clear_event_listeners() noexcept;
 
     sf::Shader m_image_shader;
@@ -233,7 +358,16 @@ private:
     std::unique_ptr<sonify::SonifyEngine> m_sonifier;
     std::string m_window_title = "Sonopix";
     std::string m_input_file   = "";
-    std::string m_output_file  = "";
+    std::string m_input_path   = ""; // m_input_file with ~ expanded
+    int m_frame_count          = 1;  // frames in the open image
+    std::string m_output_file  = ""; // "-" streams raw PCM to stdout
+    PcmWriter::Format m_pcm_format = PcmWriter::Format::S16;
+    int m_pcm_fd               = STDOUT_FILENO; // stdout before claim_stdout()
+    bool m_mmap_output         = false; // render straight into a mapped WAV
+    bool m_encoded             = false; // -o written while rendering
+    // --stream: raw frames to sonify live instead of opening a window
+    std::optional<FrameStream::Format> m_stream_format;
+    std::string m_stream_input = "-";
     sf::Vector2u m_window_size = {800, 600};
     sf::Vector2u m_win_size;
     sf::Vector2u m_tex_size;
@@ -251,12 +385,40 @@ private:
     sf::Clock m_clock;
 
     Config m_config;
+    std::future<OpenedImage> m_open_future;
+    std::string m_open_path;        // file m_open_future is decoding
+    std::string m_open_queued;      // requested while m_open_future ran
+    bool m_sonify_after_open = false; // sonify() called while opening
+    // Unset with --no-cache. Only interactive runs write to it.
+    std::optional<ImageCache> m_image_cache{std::in_place};
+    // Cache entry of the open image, the image_version() it was loaded as
+    // and the size of the polar reductions stored in it so far
+    std::optional<std::uint64_t> m_cache_key;
+    std::uint64_t m_cache_version = 0;
+    std::size_t m_polar_stored    = 0;
     std::future<void> m_sonify_future;
+    // Audio of a finished render waiting for process_func on the main thread
+    std::vector<float> m_process_audio;
     std::size_t m_last_sample_index = 0;
-    std::vector<std::pair<int, int>> m_traversal_pixels;
+    sonify::Traversal m_traversal;
+    struct TraversalJob
+    {
+        int next    = 0; // next strip index to request from traversal_func
+        int total   = 0;
+        bool active = false;
+    } m_traversal_job;
+    // Time spent calling traversal_func per frame while collecting
+    static constexpr sf::Time TRAVERSAL_FRAME_BUDGET = sf::milliseconds(8);
+    sf::Clock m_render_clock;
+    int m_last_progress_pct = -1;
     bool m_using_custom_traversal = false;
     bool m_seeking                = false;
     bool m_was_playing            = false;
     std::unordered_map<std::string, std::vector<int>> m_event_listeners;
     lua_State *m_L                = nullptr;
+    LuaStatePool m_lua_pool;
+    ScriptGuard m_script_guard;        // guards m_L
+    ScriptLimits m_cli_script_limits;  // from the command line; scripts can
+                                       // only tighten these
+    int m_exit_code = 0;
 };
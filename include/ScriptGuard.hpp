@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <lua.hpp>
+
+// Budgets for calls into user Lua functions (sonify_func, traversal_func,
+// process_func). `call_*` limits apply to each call on its own;
+// `render_seconds` bounds the whole sonification, from traversal collection
+// to process_func. Zero disables a limit.
+struct ScriptLimits
+{
+    long long call_instructions = 0;
+    double    call_seconds      = 0.0;
+    double    render_seconds    = 0.0;
+
+    inline bool any() const noexcept
+    {
+        return call_instructions > 0 || call_seconds > 0.0
+               || render_seconds > 0.0;
+    }
+
+    // Per-field minimum of two sets of limits, ignoring disabled ones.
+    static ScriptLimits tightest(const ScriptLimits &a,
+                                 const ScriptLimits &b) noexcept
+    {
+        auto pick = [](auto x, auto y)
+        { return x <= 0 ? y : (y <= 0 ? x : (x < y ? x : y)); };
+        return ScriptLimits{pick(a.call_instructions, b.call_instructions),
+                            pick(a.call_seconds, b.call_seconds),
+                            pick(a.render_seconds, b.render_seconds)};
+    }
+};
+
+/* Enforces ScriptLimits on one lua_State through a LUA_MASKCOUNT hook.
+ *
+ * The guard is reachable from the state through its extra space, so the hook
+ * and guarded_pcall() need nothing but the lua_State. When a budget runs out
+ * the hook raises a Lua error, which unwinds the call like any other error;
+ * tripped() then tells the caller it was the guard and not the script. */
+class ScriptGuard
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Lua instructions between hook invocations.
+    static constexpr int HOOK_INTERVAL = 1000;
+
+    // Attaches `guard` to `L` and installs the hook. The guard must outlive
+    // the state (or be detached with install(L, nullptr)).
+    static void install(lua_State *L, ScriptGuard *guard) noexcept;
+    static ScriptGuard *of(lua_State *L) noexcept;
+
+    void set_limits(const ScriptLimits &limits) noexcept;
+    inline const ScriptLimits &limits() const noexcept { return m_limits; }
+
+    // Starts the per-render wall-clock budget.
+    void start_render(Clock::time_point now = Clock::now()) noexcept;
+
+    // Takes the limits and render deadline of `other`, so that worker states
+    // share the budget of the render they belong to.
+    void share_budget(const ScriptGuard &other) noexcept;
+
+    // Reason the last guarded call was aborted, or nullptr if it was not.
+    inline const char *tripped() const noexcept { return m_tripped; }
+
+private:
+    friend int guarded_pcall(lua_State *L, int nargs, int nresults);
+
+    ScriptLimits m_limits;
+    Clock::time_point m_render_deadline = Clock::time_point::max();
+    Clock::time_point m_call_deadline   = Clock::time_point::max();
+    long long m_instructions            = 0;
+    const char *m_tripped               = nullptr;
+    bool m_armed                        = false; // inside guarded_pcall()
+
+    void begin_call() noexcept;
+    static void hook(lua_State *L, lua_Debug *ar);
+};
+
+// lua_pcall() under the per-call and per-render budgets of the state's guard
+// (plain lua_pcall() if it has none). On a budget error the message is left
+// on the stack as for any other error and ScriptGuard::tripped() is set.
+int guarded_pcall(lua_State *L, int nargs, int nresults);
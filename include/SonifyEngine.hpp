@@ -1,10 +1,24 @@
 #pragma once
 
+#include "BoundedQueue.hpp"
+#include "Granular.hpp"
+#include "Spectrogram.hpp"
+#include "Traversal.hpp"
+#include "Wavetable.hpp"
+
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <future>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace sonify
@@ -24,6 +38,9 @@ struct SonifyContext
     float brightness;   // luminance  [0, 1]
     float r, g, b;      // avg channel values [0, 1]
     float h, s, v;      // HSV — h in [0, 360], s/v in [0, 1]
+    // Change of brightness and r/g/b since the same strip of the previous
+    // frame of an animation; 0 for still images and first frames
+    float delta, dr, dg, db;
 
     // Traversal info (so user can do position-dependent effects)
     int x;
@@ -34,9 +51,18 @@ struct SonifyContext
     // Strip info (playback order, independent of scan direction)
     int strip_index;
     int strip_count;
+    int chunk_start; // first strip of the chunk this worker renders (0 if serial)
+    // Changes once per sonify*() call; a whole frame sequence is one call,
+    // however its strips are numbered. State kept between strips is reset
+    // when it changes.
+    std::uint64_t render_id;
 
     // Timing info for the generated audio
     float t;         // time in seconds since start of audio
+    // Phase, in 2^64ths of a cycle, that an oscillator following the
+    // frequency map from strip 0 has at the start of this strip (see
+    // phase_increment()). Lets a stateless function stay phase-continuous.
+    std::uint64_t phase;
     int   n_samples; // frames to generate (samples per channel); return n_samples * channel_count interleaved
     int   channel_count; // 1 = mono, 2 = stereo
 
@@ -47,15 +73,27 @@ struct SonifyContext
 };
 
 using SonifyFunc = std::function<void(const SonifyContext &, std::vector<float> &)>;
+// Receives a block of rendered audio (interleaved); may modify it in place
+using AudioSink = std::function<void(std::vector<float> &)>;
+// Returns zero-filled storage for `samples` samples of rendered audio
+using AudioTarget = std::function<float *(std::size_t samples)>;
 
 /* Helper function to normalize uint8_t data to float within range [0 .. 1] */
+inline void
+normalize_u8_data(const std::uint8_t *data, std::size_t size,
+                  std::vector<float> &norm_data)
+{
+    norm_data.resize(size); // keeps the storage of a recycled buffer
+    float *out = norm_data.data();
+    for (std::size_t i = 0; i < size; i++) // indexed stores vectorise
+        out[i] = static_cast<float>(data[i]) / 255.0f;
+}
+
 inline std::vector<float>
 normalize_u8_data(const std::uint8_t *data, std::size_t size)
 {
     std::vector<float> norm_data;
-    norm_data.reserve(size);
-    for (std::size_t i = 0; i < size; i++)
-        norm_data.push_back(static_cast<float>(data[i]) / 255.0f);
+    normalize_u8_data(data, size, norm_data);
     return norm_data;
 }
 
@@ -85,6 +123,110 @@ enum class Direction
     CIRCLE_INWARDS,
     ROTATE_CW,  // radar sweep clockwise from 12 o'clock
     ROTATE_CCW, // radar sweep counter-clockwise from 12 o'clock
+    ANGLE,      // straight scan towards scan_angle(), see AngleScan
+};
+
+/* Geometry of an ANGLE scan over the pixels [x0, x1) x [y0, y1). The scan
+ * moves along u = (cos a, sin a), a in degrees clockwise from left-to-right
+ * (y points down). Strip i holds the pixels whose centres project onto u
+ * within half a pixel of first + i, so 0, 90, 180 and 270 degrees give the
+ * columns and rows of the axis-aligned directions. */
+struct AngleScan
+{
+    float ux = 1.0f, uy = 0.0f;
+    float first = 0.0f; // projection of the first strip
+    int   count = 0;
+    float cx = 0.0f, cy = 0.0f; // centre of the bounds
+
+    AngleScan(float degrees, int x0, int y0, int x1, int y1) noexcept
+    {
+        const double rad = static_cast<double>(degrees) * (3.14159265358979323846 / 180.0);
+        // Exact axes for multiples of 90 degrees
+        auto snap = [](double v) { return std::abs(v) < 1e-9 ? 0.0f : static_cast<float>(v); };
+        ux = snap(std::cos(rad));
+        uy = snap(std::sin(rad));
+        cx = 0.5f * static_cast<float>(x0 + x1 - 1);
+        cy = 0.5f * static_cast<float>(y0 + y1 - 1);
+        if (x1 <= x0 || y1 <= y0)
+            return;
+
+        const float ax = static_cast<float>(x0), bx = static_cast<float>(x1 - 1);
+        const float ay = static_cast<float>(y0), by = static_cast<float>(y1 - 1);
+        const float lo = std::min({project(ax, ay), project(bx, ay),
+                                   project(ax, by), project(bx, by)});
+        const float hi = std::max({project(ax, ay), project(bx, ay),
+                                   project(ax, by), project(bx, by)});
+        first = lo;
+        count = static_cast<int>(std::floor(hi - lo + 0.5f)) + 1;
+    }
+
+    float project(float x, float y) const noexcept { return x * ux + y * uy; }
+
+    int strip_at(float x, float y) const noexcept
+    {
+        return std::clamp(static_cast<int>(std::floor(project(x, y) - first + 0.5f)),
+                          0, std::max(0, count - 1));
+    }
+
+    // Point of strip i's line through the middle of the bounds
+    std::pair<float, float> centre(int i) const noexcept
+    {
+        const float d = first + static_cast<float>(i) - project(cx, cy);
+        return {cx + d * ux, cy + d * uy};
+    }
+};
+
+/* The options that decide how many strips a scan makes of an image, copied
+ * out of the engine so loader threads can size images while they change. */
+struct ScanShape
+{
+    Direction direction = Direction::LEFT_TO_RIGHT;
+    float scan_angle    = 0.0f;
+    int   max_strips    = 0;     // 0 = no cap
+    bool  tiles         = false; // granular engine: reads tiles, not strips
+
+    // Strips the direction makes of a whole w x h image
+    int strip_count_for(int w, int h) const noexcept
+    {
+        switch (direction)
+        {
+            case Direction::LEFT_TO_RIGHT:
+            case Direction::RIGHT_TO_LEFT:   return w;
+            case Direction::TOP_TO_BOTTOM:
+            case Direction::BOTTOM_TO_TOP:   return h;
+            case Direction::ROTATE_CW:
+            case Direction::ROTATE_CCW:      return std::max(w, h);
+            case Direction::CIRCLE_OUTWARDS:
+            case Direction::CIRCLE_INWARDS:
+            {
+                const float cx = (w - 1) * 0.5f, cy = (h - 1) * 0.5f;
+                return static_cast<int>(std::sqrt(cx * cx + cy * cy)) + 2;
+            }
+            case Direction::ANGLE:           return AngleScan(scan_angle, 0, 0, w, h).count;
+        }
+        return std::max(w, h);
+    }
+
+    // Largest size with the aspect ratio of w x h that scans into at most
+    // max_strips strips; w x h itself when there is no cap, the image is
+    // already small enough, or the engine reads tiles.
+    std::pair<int, int> analysis_size(int w, int h) const noexcept
+    {
+        if (max_strips <= 0 || tiles || w <= 0 || h <= 0
+            || strip_count_for(w, h) <= max_strips)
+            return {w, h};
+
+        double scale = static_cast<double>(max_strips) / strip_count_for(w, h);
+        int sw = 1, sh = 1;
+        for (;; scale *= 0.99)
+        {
+            sw = std::max(1, static_cast<int>(w * scale));
+            sh = std::max(1, static_cast<int>(h * scale));
+            if (strip_count_for(sw, sh) <= max_strips || (sw == 1 && sh == 1))
+                break;
+        }
+        return {sw, sh};
+    }
 };
 
 struct FreqMap
@@ -94,39 +236,77 @@ struct FreqMap
     FreqScale scale = FreqScale::LINEAR;
 };
 
+/* How strips become audio */
+enum class Engine
+{
+    STRIPS = 0,  // one sonify_func call per strip (default)
+    SPECTROGRAM, // each column (or row) is a magnitude spectrum; inverse STFT
+    WAVETABLE,   // each column (or row) is a single-cycle waveform
+    GRANULAR,    // image tiles seed sine grains
+};
+
+struct SpectrogramOpts
+{
+    int fft_size    = 0; // 0 = pick from the hop size
+    int griffin_lim = 0; // phase reconstruction iterations (0 = off)
+};
+
+/* Frequency for brightness `b` in [0, 1] */
+inline float
+map_frequency(float b, FreqScale scale, float fmin, float fmax) noexcept
+{
+    switch (scale)
+    {
+        case FreqScale::LOG:
+            return fmin * std::pow(fmax / fmin, b);
+        case FreqScale::EXPONENTIAL:
+            return fmin * std::exp(b * std::log(fmax / fmin));
+        default:
+            return fmin + b * (fmax - fmin);
+    }
+}
+
+/* Per-sample phase increment of an oscillator at `freq` Hz, in 2^64ths of a
+ * cycle. Phase is fixed point so that it wraps for free and the phase at any
+ * strip is an exact sum of the increments before it, whichever thread (or
+ * order) computes it. */
+inline std::uint64_t
+phase_increment(float freq, float sample_rate) noexcept
+{
+    double cycles = static_cast<double>(freq) / static_cast<double>(sample_rate);
+    cycles -= std::floor(cycles);
+    return static_cast<std::uint64_t>(std::ldexp(cycles, 64));
+}
+
+/* Fixed-point phase to radians in [0, 2pi) */
+inline float
+phase_radians(std::uint64_t phase) noexcept
+{
+    constexpr double two_pi = 6.283185307179586;
+    return static_cast<float>(std::ldexp(static_cast<double>(phase >> 11), -53)
+                              * two_pi);
+}
+
 namespace sonify_functions
 {
 
+// Stateless: the starting phase of each strip comes from ctx.phase, so strips
+// can be rendered on any thread and the result does not depend on how they
+// were split.
 inline SonifyFunc
 sine()
 {
-    float phase = 0.0f;
-
-    return [phase](const SonifyContext &ctx, std::vector<float> &out) mutable
+    return [](const SonifyContext &ctx, std::vector<float> &out)
     {
-        const float b = std::clamp(ctx.brightness, 0.0f, 1.0f);
+        const float b    = std::clamp(ctx.brightness, 0.0f, 1.0f);
+        const float freq = map_frequency(b, ctx.freq_scale, ctx.fmin, ctx.fmax);
+        const std::uint64_t inc = phase_increment(freq, ctx.sample_rate);
 
-        float freq;
-        switch (ctx.freq_scale)
-        {
-            case FreqScale::LOG:
-                freq = ctx.fmin * std::pow(ctx.fmax / ctx.fmin, b);
-                break;
-            case FreqScale::EXPONENTIAL:
-                freq = ctx.fmin * std::exp(b * std::log(ctx.fmax / ctx.fmin));
-                break;
-            default:
-                freq = ctx.fmin + b * (ctx.fmax - ctx.fmin);
-                break;
-        }
-
-        constexpr float two_pi = 6.28318530718f;
+        std::uint64_t phase = ctx.phase;
         for (int i = 0; i < ctx.n_samples; ++i)
         {
-            phase += two_pi * freq / ctx.sample_rate;
-            if (phase >= two_pi)
-                phase -= two_pi;
-            const float s = b * std::sin(phase);
+            phase += inc;
+            const float s = b * std::sin(phase_radians(phase));
             for (int ch = 0; ch < ctx.channel_count; ++ch)
                 out.push_back(s);
         }
@@ -147,10 +327,81 @@ class SonifyEngine
 public:
     SonifyEngine() = default;
 
+    // Replacing the image with identical pixels keeps image_version(), so
+    // per-image caches survive re-sonifying an unchanged image.
     inline void set_raw_image(int w, int h, int ch, int stride,
                               std::vector<float> &&data) noexcept
     {
+        if (w == m_img.width && h == m_img.height && ch == m_img.channels
+            && stride == m_img.stride && data == m_img.data)
+            return;
         m_img = RawImage{w, h, ch, stride, std::move(data)};
+        ++m_image_version;
+    }
+    inline std::uint64_t image_version() const noexcept { return m_image_version; }
+
+    // The whole-image polar reductions (rotate rays, circle rings) of image
+    // `version` as bytes, so they can be kept between runs; empty unless at
+    // least one of them has been built for that image without an ROI. A
+    // part not built yet is stored empty.
+    std::vector<std::uint8_t> save_polar(std::uint64_t version) const
+    {
+        const PolarKey whole{version, 0, 0, m_img.width, m_img.height};
+        if (version != m_image_version)
+            return {};
+        const bool rays  = m_rays_key == whole && !m_polar.rays.empty();
+        const bool rings = m_rings_key == whole && !m_polar.rings.empty();
+        if (!rays && !rings)
+            return {};
+
+        const std::uint32_t counts[2] = {
+            rays ? static_cast<std::uint32_t>(m_polar.rays.size()) : 0u,
+            rings ? static_cast<std::uint32_t>(m_polar.rings.size()) : 0u};
+        const std::size_t ray_bytes  = counts[0] * sizeof(Strip);
+        const std::size_t ring_bytes = counts[1] * sizeof(StripData);
+        std::vector<std::uint8_t> out(sizeof(counts) + ray_bytes + ring_bytes);
+        std::memcpy(out.data(), counts, sizeof(counts));
+        if (rays)
+            std::memcpy(out.data() + sizeof(counts), m_polar.rays.data(), ray_bytes);
+        if (rings)
+            std::memcpy(out.data() + sizeof(counts) + ray_bytes, m_polar.rings.data(), ring_bytes);
+        return out;
+    }
+
+    // Adopts bytes from save_polar() as the current image's whole-image
+    // reductions. Returns false, keeping nothing, if they do not fit it.
+    bool load_polar(const std::uint8_t *data, std::size_t size)
+    {
+        static_assert(std::is_trivially_copyable_v<Strip>);
+        std::uint32_t counts[2];
+        if (m_img.data.empty() || size < sizeof(counts))
+            return false;
+        std::memcpy(counts, data, sizeof(counts));
+
+        const std::size_t ray_bytes  = std::size_t(counts[0]) * sizeof(Strip);
+        const std::size_t ring_bytes = std::size_t(counts[1]) * sizeof(StripData);
+        if ((counts[0] != 0
+             && counts[0] != static_cast<std::uint32_t>(std::max(m_img.width, m_img.height)))
+            || (counts[1] != 0
+                && counts[1] != static_cast<std::uint32_t>(polar_max_radius() + 1))
+            || (counts[0] == 0 && counts[1] == 0)
+            || size != sizeof(counts) + ray_bytes + ring_bytes)
+            return false;
+
+        const PolarKey whole{m_image_version, 0, 0, m_img.width, m_img.height};
+        if (counts[0] != 0)
+        {
+            m_polar.rays.resize(counts[0]);
+            std::memcpy(m_polar.rays.data(), data + sizeof(counts), ray_bytes);
+            m_rays_key = whole;
+        }
+        if (counts[1] != 0)
+        {
+            m_polar.rings.resize(counts[1]);
+            std::memcpy(m_polar.rings.data(), data + sizeof(counts) + ray_bytes, ring_bytes);
+            m_rings_key = whole;
+        }
+        return true;
     }
 
     const RawImage &raw_image() const noexcept { return m_img; }
@@ -165,6 +416,37 @@ public:
     inline void      set_direction(Direction dir) noexcept { m_direction = dir; }
     inline Direction direction() const noexcept            { return m_direction; }
 
+    // Scan direction of Direction::ANGLE, in degrees clockwise from
+    // left-to-right.
+    inline void  set_scan_angle(float degrees) noexcept { m_scan_angle = degrees; }
+    inline float scan_angle() const noexcept            { return m_scan_angle; }
+    AngleScan angle_scan() const noexcept
+    {
+        const auto [x0, y0, x1, y1] = effective_bounds();
+        return AngleScan(m_scan_angle, x0, y0, x1, y1);
+    }
+
+    // Cap on the strips a scan needs (0 = none). Images are only ever
+    // averaged into that many strips, so loaders may decode them at the
+    // reduced ScanShape::analysis_size() instead of their full resolution.
+    inline void set_max_strips(int n) noexcept { m_max_strips = std::max(0, n); }
+    inline int  max_strips() const noexcept    { return m_max_strips; }
+
+    // Snapshot of the options that decide how many strips an image makes
+    ScanShape scan_shape() const noexcept
+    {
+        return {m_direction, m_scan_angle, m_max_strips, m_engine == Engine::GRANULAR};
+    }
+
+    inline void   set_engine(Engine engine) noexcept { m_engine = engine; }
+    inline Engine engine() const noexcept            { return m_engine; }
+
+    inline void set_spectrogram_opts(const SpectrogramOpts &opts) noexcept { m_spectrogram = opts; }
+    inline const SpectrogramOpts &spectrogram_opts() const noexcept       { return m_spectrogram; }
+
+    inline void set_granular_opts(const GranularOpts &opts) noexcept { m_granular = opts; }
+    inline const GranularOpts &granular_opts() const noexcept       { return m_granular; }
+
     inline void set_freq_map(FreqMap f) noexcept              { m_freq_map = f; }
     inline FreqMap freq_map() const noexcept                  { return m_freq_map; }
     inline void set_freq_range(float fmin, float fmax) noexcept
@@ -178,45 +460,150 @@ public:
     std::vector<float>       &audio() noexcept             { return m_audio_data; }
     inline std::vector<float> take_audio() noexcept        { return std::move(m_audio_data); }
 
-    // Custom pixel-order traversal: each pair (x, y) becomes one strip whose
-    // brightness is the single pixel at that coordinate.
-    void sonify_with_pixels(const std::vector<std::pair<int, int>> &pixels)
+    // When set, the strips engine (images, traversals and frame sequences)
+    // and the wavetable engine, which renders through the same strips,
+    // hand their audio to `sink` in blocks of a few hundred thousand
+    // samples, in order, as they render them, and keep none: audio() stays
+    // empty and memory no longer grows with the length of the render. The
+    // spectrogram and granular engines ignore it and fill audio() as usual.
+    // Called on the thread that sonifies.
+    inline void set_audio_sink(AudioSink sink) noexcept { m_audio_sink = std::move(sink); }
+
+    // When set (and no audio sink is), a render through the strips pipeline
+    // (the strips and wavetable engines, images and traversals) asks
+    // `target` for storage once it knows its length and renders straight
+    // into it, every thread writing its strips at their final offsets,
+    // instead of into audio(), which stays empty. The storage must stay
+    // valid until the render returns; a target that cannot provide it
+    // should throw. Frame sequences throw if a target is set; the
+    // spectrogram and granular engines ignore it and fill audio().
+    inline void set_audio_target(AudioTarget target) noexcept { m_audio_target = std::move(target); }
+
+    // Custom pixel-order traversal: each traversal pixel becomes one strip
+    // whose brightness is the single pixel at that coordinate.
+    void sonify_traversal(const Traversal &traversal)
     {
         validate();
-        const int w     = m_img.width;
-        const int h     = m_img.height;
-        const int spu   = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
-        const int total = static_cast<int>(pixels.size());
-        m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(total) * spu * m_channel_count);
-        for (int i = 0; i < total; ++i)
+        ++m_render_id;
+        render_strips(static_cast<int>(traversal.size()),
+                      [&](int begin, int end, auto &&sink)
         {
-            const auto [x, y] = pixels[i];
-            const float *px = &m_img.data[y * m_img.stride + x * m_img.channels];
-            const float r = px[0];
-            const float g = (m_img.channels >= 3) ? px[1] : px[0];
-            const float b = (m_img.channels >= 3) ? px[2] : px[0];
-            emit_strip(make_strip_data(r, g, b), x, y, w, h, spu, i, total);
-        }
+            traversal.for_each(begin, end, [&](int x, int y, std::size_t i)
+            {
+                const float *px = &m_img.data[y * m_img.stride + x * m_img.channels];
+                const float r = px[0];
+                const float g = (m_img.channels >= 3) ? px[1] : px[0];
+                const float b = (m_img.channels >= 3) ? px[2] : px[0];
+                sink(static_cast<int>(i), Strip{make_strip_data(r, g, b), x, y});
+            });
+        });
     }
 
-    inline void set_sonify_func(const SonifyFunc &func) noexcept { m_sonify_func = func; }
-    const SonifyFunc &sonify_func() const noexcept               { return m_sonify_func; }
+    // `thread_safe` marks a function that may be called concurrently and
+    // keeps no state between strips (it may use ctx.phase); such a function
+    // is rendered on up to thread_count() threads.
+    inline void set_sonify_func(const SonifyFunc &func,
+                                bool thread_safe = false) noexcept
+    {
+        m_sonify_func             = func;
+        m_sonify_func_thread_safe = thread_safe;
+    }
+    const SonifyFunc &sonify_func() const noexcept { return m_sonify_func; }
+
+    // Strip memoization, for sonify functions whose output depends only on
+    // the strip colour (not on phase, t, position, strip index or delta). With
+    // `levels` >= 2, r, g and b are quantized to that many levels and a strip
+    // whose quantized colour was already rendered in the same chunk copies
+    // that audio instead of calling the function; strips that rendered
+    // silent are skipped outright. 0 turns it off. Engine functions
+    // (wavetable, ...) are never memoized.
+    inline void set_memoize_levels(int levels) noexcept
+    {
+        m_memo_levels = levels >= 2 ? std::min(levels, 1 << 16) : 0;
+    }
+    inline int memoize_levels() const noexcept { return m_memo_levels; }
+
+    inline void set_thread_count(int n) noexcept { m_thread_count = std::max(1, n); }
+    inline int  thread_count() const noexcept    { return m_thread_count; }
+
+    // Independent sonify functions, one per worker thread (e.g. one per Lua
+    // state), used in place of sonify_func() while set. One is rendered
+    // serially; with more, strips are split into contiguous chunks rendered
+    // in parallel, chunk i by funcs[i].
+    inline void set_worker_funcs(std::vector<SonifyFunc> funcs) noexcept
+    {
+        m_worker_funcs = std::move(funcs);
+    }
+    inline std::size_t worker_count() const noexcept { return m_worker_funcs.size(); }
+
+    // Cooperative cancellation and progress. Safe to call from another thread
+    // while a render is running: cancel() is checked between strips and a
+    // cancelled render leaves no audio behind. reset_progress() must be
+    // called before starting a render, not from within it, so that a cancel
+    // issued before the render thread starts is not lost.
+    inline void cancel() noexcept { m_cancel.store(true, std::memory_order_relaxed); }
+    inline bool cancelled() const noexcept
+    {
+        return m_cancel.load(std::memory_order_relaxed);
+    }
+    inline void reset_progress() noexcept
+    {
+        m_cancel.store(false, std::memory_order_relaxed);
+        m_strips_done.store(0, std::memory_order_relaxed);
+        m_strips_total.store(0, std::memory_order_relaxed);
+    }
+    // Strips per frame of the last frame sequence rendered, or 0 when the
+    // last sonification was a single image.
+    inline int frame_strips() const noexcept
+    {
+        return m_frame_strips.load(std::memory_order_relaxed);
+    }
+    // Fraction of strips rendered so far, in [0, 1].
+    inline float progress() const noexcept
+    {
+        const int total = m_strips_total.load(std::memory_order_relaxed);
+        if (total <= 0)
+            return 0.0f;
+        return static_cast<float>(m_strips_done.load(std::memory_order_relaxed))
+               / static_cast<float>(total);
+    }
 
     inline void set_channel_count(int ch) noexcept { m_channel_count = std::max(1, ch); }
     inline int  channel_count() const noexcept     { return m_channel_count; }
 
+    // Original-image pixels per pixel of the buffer, for an image a loader
+    // decoded at a reduced analysis_size(). The ROI, pixel_brightness_at()
+    // and ctx.x/y/width/height are in original-image pixels and scaled into
+    // the buffer here, so scripts need not know about max_strips. Kept
+    // across set_raw_image(); 1 by default.
+    inline void set_source_scale(double sx, double sy) noexcept
+    {
+        m_source_sx = sx > 0.0 ? sx : 1.0;
+        m_source_sy = sy > 0.0 ? sy : 1.0;
+    }
+    inline int source_width() const noexcept
+    {
+        return static_cast<int>(std::lround(m_img.width * m_source_sx));
+    }
+    inline int source_height() const noexcept
+    {
+        return static_cast<int>(std::lround(m_img.height * m_source_sy));
+    }
+
+    // In original-image pixels, see set_source_scale()
     void set_roi(int x, int y, int w, int h) noexcept
     {
+        const int sw = source_width();
+        const int sh = source_height();
         m_roi = ROI{
-            std::clamp(x, 0, m_img.width),
-            std::clamp(y, 0, m_img.height),
-            std::clamp(w, 1, m_img.width),
-            std::clamp(h, 1, m_img.height),
+            std::clamp(x, 0, sw),
+            std::clamp(y, 0, sh),
+            std::clamp(w, 1, sw),
+            std::clamp(h, 1, sh),
             true
         };
-        m_roi.w = std::min(m_roi.w, m_img.width  - m_roi.x);
-        m_roi.h = std::min(m_roi.h, m_img.height - m_roi.y);
+        m_roi.w = std::min(m_roi.w, sw - m_roi.x);
+        m_roi.h = std::min(m_roi.h, sh - m_roi.y);
     }
     void        clear_roi() noexcept          { m_roi.active = false; }
     const ROI  &roi() const noexcept          { return m_roi; }
@@ -224,31 +611,236 @@ public:
 
     float pixel_brightness_at(int x, int y) const noexcept
     {
+        const int bx = static_cast<int>(std::floor(x / m_source_sx));
+        const int by = static_cast<int>(std::floor(y / m_source_sy));
         if (m_img.data.empty()
-            || x < 0 || x >= m_img.width
-            || y < 0 || y >= m_img.height)
+            || bx < 0 || bx >= m_img.width
+            || by < 0 || by >= m_img.height)
             return 0.0f;
         return pixel_brightness(
-            &m_img.data[y * m_img.stride + x * m_img.channels],
+            &m_img.data[by * m_img.stride + bx * m_img.channels],
             m_img.channels);
     }
 
     void validate() const
+    {
+        validate_settings();
+        validate_image(m_img);
+    }
+
+    void validate_settings() const
     {
         if (!m_sonify_func)
             throw std::runtime_error("sonify: `sonify_func' not set");
-        if (m_img.data.empty())
-            throw std::runtime_error("sonify: raw_image data is empty");
         if (m_sample_rate <= 0.0f)
             throw std::runtime_error("sonify: invalid `sample_rate'");
         if (m_secs_per_unit <= 0.0f)
             throw std::runtime_error("sonify: invalid `seconds_per_unit'");
     }
 
+    static void validate_image(const RawImage &img)
+    {
+        if (img.data.empty())
+            throw std::runtime_error("sonify: raw_image data is empty");
+        if (img.channels != 1 && img.channels != 3 && img.channels != 4)
+            throw std::runtime_error("sonify: raw_image must have 1, 3 or 4 channels");
+    }
+
     void sonify()
     {
         validate();
+        ++m_render_id;
+        m_frame_strips.store(0, std::memory_order_relaxed);
 
+        if (m_engine == Engine::SPECTROGRAM)
+        {
+            sonify_spectrogram();
+            return;
+        }
+        if (m_engine == Engine::WAVETABLE)
+        {
+            sonify_wavetable();
+            return;
+        }
+        if (m_engine == Engine::GRANULAR)
+        {
+            sonify_granular();
+            return;
+        }
+
+        sonify_direction();
+    }
+
+    // Sonifies `frame_count` frames, all of one size, back to
+    // back into one continuous stream: strip numbering, `t` and the
+    // oscillator phase carry on from one frame to the next. next_frame(img)
+    // fills in the next frame and returns false when there are none left;
+    // `img` holds the storage of a spent frame when one is free, so filling
+    // it with assign() or resize() allocates nothing once the pipeline runs.
+    // A frame_count <= 0 leaves the sequence open-ended; with no total to
+    // count against, each frame is then numbered on its own: strip_index,
+    // strip_count and t restart with every frame (so strip_index /
+    // strip_count is the progress through the frame and t the time since
+    // its start), while the phase and render_id carry on, so oscillators
+    // and voice state stay continuous. The ROI is scaled into and
+    // intersected with each frame, so one set for a larger image cannot
+    // read outside it; an ROI that misses the frame altogether scans the
+    // whole frame.
+    //
+    // Without `on_audio` the whole sequence ends up in audio(). With it,
+    // each frame's audio is handed to on_audio() as soon as it is rendered,
+    // on the calling thread, and none is kept: a live stream can run
+    // indefinitely, and a slow consumer holds the pipeline back rather than
+    // letting frames pile up.
+    //
+    // Three stages overlap on their own threads, joined by short queues:
+    // frame N+1 is decoded while frame N is reduced to strips (by a second
+    // engine with this one's scan settings) and frame N-1 is rendered here,
+    // so the slowest stage sets the pace rather than the sum of all three.
+    // Frames are reduced against the one before (reduce_frame()), and each
+    // strip's change since then reaches the sonify function as ctx.delta,
+    // dr, dg and db. Only the strips engine scans sequences.
+    void sonify_frames(int frame_count,
+                       const std::function<bool(RawImage &)> &next_frame,
+                       const AudioSink &on_audio = {})
+    {
+        validate_settings();
+        if (m_engine != Engine::STRIPS)
+            throw std::runtime_error("sonify: frame sequences need the `strips' engine");
+        if (m_audio_target)
+            throw std::runtime_error("sonify: frame sequences cannot render into an audio target");
+        m_frame_strips.store(0, std::memory_order_relaxed);
+        ++m_render_id;
+
+        SonifyEngine reducer;
+        reducer.m_direction    = m_direction;
+        reducer.m_scan_angle   = m_scan_angle;
+        reducer.m_thread_count = m_thread_count;
+
+        BoundedQueue<RawImage> frames(2);
+        BoundedQueue<ReducedFrame> reduced(2);
+        // Pixel buffers of reduced frames, back to the decoder for reuse
+        BoundedQueue<std::vector<float>> spare(2);
+
+        auto decode = std::async(std::launch::async, [&]
+        {
+            try
+            {
+                RawImage img;
+                while (!cancelled())
+                {
+                    spare.try_pop(img.data);
+                    if (!next_frame(img) || !frames.push(std::move(img)))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                frames.close();
+                throw;
+            }
+            frames.close();
+        });
+
+        auto reduce = std::async(std::launch::async, [&]
+        {
+            try
+            {
+                RawImage img;
+                DeltaState state;
+                while (!cancelled() && frames.pop(img))
+                {
+                    validate_image(img);
+                    reducer.m_roi = buffer_roi(img.width, img.height);
+                    reducer.m_img = std::move(img);
+                    ++reducer.m_image_version;
+                    ReducedFrame frame;
+                    frame.width  = reducer.m_img.width;
+                    frame.height = reducer.m_img.height;
+                    reducer.reduce_frame(state, frame);
+                    spare.try_push(std::move(reducer.m_img.data));
+                    if (!reduced.push(std::move(frame)))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                frames.close();
+                reduced.close();
+                throw;
+            }
+            // Stopping early must not leave the decoder blocked on a push
+            frames.close();
+            reduced.close();
+        });
+
+        std::vector<float> stream;
+        std::exception_ptr error;
+        try
+        {
+            const int spu = samples_per_unit();
+            ReducedFrame frame;
+            while (!cancelled() && reduced.pop(frame))
+            {
+                const std::vector<Strip> &strips = frame.strips;
+                const int n = static_cast<int>(strips.size());
+                m_delta         = frame.delta.data();
+                m_stream.width  = frame.width;
+                m_stream.height = frame.height;
+                if (m_stream.total_strips == 0 && frame_count > 0)
+                    m_stream.total_strips = n * frame_count;
+                render_strips(n, [&](int begin, int end, auto &&sink)
+                {
+                    for (int i = begin; i < end; ++i)
+                        sink(i, strips[static_cast<std::size_t>(i)]);
+                });
+                if (cancelled())
+                    break;
+
+                for (const Strip &s : strips)
+                    m_stream.phase += phase_advance(s, spu);
+                if (frame_count > 0)
+                    m_stream.first_strip += n;
+                m_frame_strips.store(n, std::memory_order_relaxed);
+                if (on_audio)
+                    on_audio(m_audio_data);
+                else
+                    stream.insert(stream.end(), m_audio_data.begin(), m_audio_data.end());
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            cancel();
+        }
+        reduced.close();
+        frames.close();
+        m_stream = {};
+        m_delta  = nullptr;
+
+        for (auto *stage : {&decode, &reduce})
+        {
+            try
+            {
+                stage->get();
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        m_audio_data.clear();
+        if (error)
+            std::rethrow_exception(error);
+        if (!cancelled())
+            m_audio_data = std::move(stream);
+    }
+
+private:
+    void sonify_direction()
+    {
         switch (m_direction)
         {
             case Direction::LEFT_TO_RIGHT:   sonify_left_to_right(); break;
@@ -259,25 +851,88 @@ public:
             case Direction::CIRCLE_INWARDS:  sonify_circle(false);   break;
             case Direction::ROTATE_CW:       sonify_rotate(true);    break;
             case Direction::ROTATE_CCW:      sonify_rotate(false);   break;
+            case Direction::ANGLE:           sonify_angle();         break;
         }
     }
 
-private:
     float m_sample_rate   = 44100.0f;
     int   m_channel_count = 1;
     RawImage m_img;
+    std::uint64_t m_image_version = 0;
     Direction m_direction = Direction::LEFT_TO_RIGHT;
+    float m_scan_angle    = 0.0f;
+    int   m_max_strips    = 0;
+    Engine m_engine       = Engine::STRIPS;
+    SpectrogramOpts m_spectrogram;
+    GranularOpts m_granular;
     float m_secs_per_unit = 0.001f;
     FreqMap m_freq_map;
-    ROI m_roi;
+    ROI m_roi; // in original-image pixels
+    double m_source_sx = 1.0;
+    double m_source_sy = 1.0;
     std::vector<float> m_audio_data;
+    AudioSink m_audio_sink;
+    AudioTarget m_audio_target;
     SonifyFunc m_sonify_func = sonify_functions::sine();
+    bool m_sonify_func_thread_safe = true;
+    int  m_memo_levels = 0;
+    int  m_thread_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<SonifyFunc> m_worker_funcs;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<int>  m_strips_done{0};
+    std::atomic<int>  m_strips_total{0};
+    std::atomic<int>  m_frame_strips{0};
+    std::uint64_t m_render_id = 0; // see SonifyContext::render_id
+
+    // Wavetables of the last image/bounds/orientation they were built for
+    struct WavetableKey
+    {
+        std::uint64_t version;
+        int x0, y0, x1, y1;
+        bool columns;
+        bool operator==(const WavetableKey &) const = default;
+    };
+    WavetableBank m_wavetables;
+    WavetableKey  m_wavetable_key{};
+    GrainPool m_grains;
+
+    // `roi` intersected with a width x height image; inactive if it misses
+    static ROI fit_roi(const ROI &roi, int width, int height) noexcept
+    {
+        if (!roi.active)
+            return roi;
+        const int x0 = std::clamp(roi.x, 0, width);
+        const int y0 = std::clamp(roi.y, 0, height);
+        const int x1 = std::clamp(roi.x + roi.w, 0, width);
+        const int y1 = std::clamp(roi.y + roi.h, 0, height);
+        if (x1 <= x0 || y1 <= y0)
+            return ROI{};
+        return ROI{x0, y0, x1 - x0, y1 - y0, true};
+    }
+
+    // The ROI scaled from original-image pixels into a width x height
+    // buffer (outwards, so it never shrinks to nothing) and fitted to it
+    ROI buffer_roi(int width, int height) const noexcept
+    {
+        if (!m_roi.active)
+            return m_roi;
+        const auto lo = [](int v, double s)
+        { return static_cast<int>(std::floor(v / s)); };
+        const auto hi = [](int v, double s)
+        { return static_cast<int>(std::ceil(v / s)); };
+        const int x0 = lo(m_roi.x, m_source_sx);
+        const int y0 = lo(m_roi.y, m_source_sy);
+        return fit_roi(ROI{x0, y0, hi(m_roi.x + m_roi.w, m_source_sx) - x0,
+                           hi(m_roi.y + m_roi.h, m_source_sy) - y0, true},
+                       width, height);
+    }
 
     struct Bounds { int x0, y0, x1, y1; };
     Bounds effective_bounds() const noexcept
     {
-        if (m_roi.active)
-            return {m_roi.x, m_roi.y, m_roi.x + m_roi.w, m_roi.y + m_roi.h};
+        const ROI roi = buffer_roi(m_img.width, m_img.height);
+        if (roi.active)
+            return {roi.x, roi.y, roi.x + roi.w, roi.y + roi.h};
         return {0, 0, m_img.width, m_img.height};
     }
 
@@ -315,49 +970,553 @@ private:
         throw std::runtime_error("Unsupported channel count");
     }
 
-    StripData column_data(int x, int y0, int y1) const
+    // How an aggregation treats alpha: strips of the column/row directions
+    // leave out transparent pixels (alpha < 0.5), all others read every
+    // pixel as is.
+    enum class Alpha { IGNORE, SKIP_TRANSPARENT };
+
+    // Pixel layout fixed at compile time, so that aggregation loops carry no
+    // per-pixel channel or alpha tests and vectorize. with_layout() picks the
+    // instance once per call; validate() restricts images to 1, 3 or 4
+    // channels.
+    template <int C, Alpha A>
+    struct Layout
     {
-        float sr = 0.f, sg = 0.f, sb = 0.f;
-        int count = 0;
-        for (int y = y0; y < y1; ++y)
+        static constexpr int CHANNELS = C;
+        static float r(const float *px) noexcept { return px[0]; }
+        static float g(const float *px) noexcept { return px[C >= 3 ? 1 : 0]; }
+        static float b(const float *px) noexcept { return px[C >= 3 ? 2 : 0]; }
+        // 1 if the pixel counts towards an average, else 0 (a multiply
+        // rather than a branch, which would keep loops from vectorizing)
+        static float weight(const float *px) noexcept
         {
-            const float *px = &m_img.data[y * m_img.stride + x * m_img.channels];
-            if (m_img.channels >= 4 && px[3] < 0.5f)
-                continue;
-            sr += px[0];
-            sg += (m_img.channels >= 3) ? px[1] : px[0];
-            sb += (m_img.channels >= 3) ? px[2] : px[0];
-            ++count;
+            if constexpr (C == 4 && A == Alpha::SKIP_TRANSPARENT)
+                return static_cast<float>(px[3] >= 0.5f);
+            else
+                return 1.0f;
+        }
+    };
+
+    template <Alpha A, typename Fn>
+    decltype(auto) with_layout(Fn &&fn) const
+    {
+        switch (m_img.channels)
+        {
+            case 1:  return fn(Layout<1, A>{});
+            case 3:  return fn(Layout<3, A>{});
+            default: return fn(Layout<4, A>{});
         }
-        if (count == 0)
-            return make_strip_data(0.f, 0.f, 0.f);
-        const float n = static_cast<float>(count);
-        return make_strip_data(sr / n, sg / n, sb / n);
     }
 
-    StripData row_data(int y, int x0, int x1) const
+    // Colour sums of a set of pixels and the number that counted
+    struct Sum
     {
-        float sr = 0.f, sg = 0.f, sb = 0.f;
-        int count = 0;
-        for (int x = x0; x < x1; ++x)
+        float r = 0.f, g = 0.f, b = 0.f, n = 0.f;
+
+        StripData mean() const noexcept
+        {
+            if (n <= 0.f)
+                return make_strip_data(0.f, 0.f, 0.f);
+            return make_strip_data(r / n, g / n, b / n);
+        }
+    };
+
+    static constexpr int AGG_LANES = 8;
+
+    // Sums `n` pixels `step` floats apart. Loops run in fixed blocks of
+    // AGG_LANES with one partial sum per lane: GCC only vectorizes float
+    // reductions it may reorder, and at -O2 only loops of constant trip
+    // count.
+    template <typename L>
+    static Sum sum_run(const float *px, int n, std::ptrdiff_t step) noexcept
+    {
+        float r[AGG_LANES] = {}, g[AGG_LANES] = {}, b[AGG_LANES] = {}, w[AGG_LANES] = {};
+        const int blocked = n - n % AGG_LANES;
+        for (int i = 0; i < blocked; i += AGG_LANES)
+            for (int j = 0; j < AGG_LANES; ++j)
+            {
+                const float *p = px + (i + j) * step;
+                const float  k = L::weight(p);
+                r[j] += k * L::r(p);
+                g[j] += k * L::g(p);
+                b[j] += k * L::b(p);
+                w[j] += k;
+            }
+        Sum s;
+        for (int i = blocked; i < n; ++i)
+        {
+            const float *p = px + i * step;
+            const float  k = L::weight(p);
+            s.r += k * L::r(p);
+            s.g += k * L::g(p);
+            s.b += k * L::b(p);
+            s.n += k;
+        }
+        for (int j = 0; j < AGG_LANES; ++j)
+        {
+            s.r += r[j];
+            s.g += g[j];
+            s.b += b[j];
+            s.n += w[j];
+        }
+        return s;
+    }
+
+    // Adds `n` consecutive pixels of a row to per-column sums, stored as
+    // r, g, b, n quadruples.
+    template <typename L>
+    static void add_row(const float *__restrict row, float *__restrict acc, int n) noexcept
+    {
+        auto add = [&](int x)
+        {
+            const float *p = row + x * L::CHANNELS;
+            float       *a = acc + 4 * x;
+            const float  k = L::weight(p);
+            a[0] += k * L::r(p);
+            a[1] += k * L::g(p);
+            a[2] += k * L::b(p);
+            a[3] += k;
+        };
+        const int blocked = n - n % AGG_LANES;
+        for (int x = 0; x < blocked; x += AGG_LANES)
+            for (int j = 0; j < AGG_LANES; ++j)
+                add(x + j);
+        for (int x = blocked; x < n; ++x)
+            add(x);
+    }
+
+    // Pixels per thread below which frame_data() stays on one thread
+    static constexpr int MIN_BAND_PIXELS = 1 << 18;
+
+    // Mean colour of every column (columns = true) or row within the bounds,
+    // in image order, transparent pixels left out. The image is read once,
+    // front to back, in bands of rows summed in parallel: walking each
+    // column down the image would touch a new cache line per pixel.
+    std::vector<StripData> frame_data(bool columns)
+    {
+        const auto [x0, y0, x1, y1] = effective_bounds();
+        const int w = x1 - x0, h = y1 - y0;
+        if (w <= 0 || h <= 0)
+            return {};
+
+        const int bands = static_cast<int>(std::clamp<long long>(
+            static_cast<long long>(w) * h / MIN_BAND_PIXELS, 1,
+            std::min(m_thread_count, h)));
+        std::vector<StripData> out(static_cast<std::size_t>(columns ? w : h));
+
+        with_layout<Alpha::SKIP_TRANSPARENT>([&](auto layout)
+        {
+            using L = decltype(layout);
+            const float *data = m_img.data.data();
+            auto row_at = [&](int y)
+            {
+                return data + static_cast<std::size_t>(y) * m_img.stride
+                       + static_cast<std::size_t>(x0) * L::CHANNELS;
+            };
+
+            if (!columns)
+            {
+                run_chunks(bands, h, [&](int, int begin, int end)
+                {
+                    for (int i = begin; i < end && !cancelled(); ++i)
+                        out[static_cast<std::size_t>(i)]
+                            = sum_run<L>(row_at(y0 + i), w, L::CHANNELS).mean();
+                });
+                return;
+            }
+
+            std::vector<float> acc(static_cast<std::size_t>(bands) * 4 * w, 0.0f);
+            run_chunks(bands, h, [&](int c, int begin, int end)
+            {
+                float *a = acc.data() + static_cast<std::size_t>(c) * 4 * w;
+                for (int i = begin; i < end && !cancelled(); ++i)
+                    add_row<L>(row_at(y0 + i), a, w);
+            });
+            for (int x = 0; x < w; ++x)
+            {
+                Sum s;
+                for (int c = 0; c < bands; ++c)
+                {
+                    const float *a = acc.data() + (static_cast<std::size_t>(c) * w + x) * 4;
+                    s.r += a[0];
+                    s.g += a[1];
+                    s.b += a[2];
+                    s.n += a[3];
+                }
+                out[static_cast<std::size_t>(x)] = s.mean();
+            }
+        });
+        return out;
+    }
+
+    // Mean colour of every strip of an ANGLE scan, transparent pixels left
+    // out. The image is read once, front to back, in bands of rows like
+    // frame_data(). Within a row a strip covers a run of about 1 / |cos a|
+    // pixels: runs of SHORT_RUN or more have their end solved from the
+    // projection and are summed as a block, shorter ones are binned pixel by
+    // pixel.
+    static constexpr int SHORT_RUN = 8;
+
+    std::vector<StripData> angle_data(const AngleScan &scan)
+    {
+        const auto [x0, y0, x1, y1] = effective_bounds();
+        const int w = x1 - x0, h = y1 - y0;
+        if (w <= 0 || h <= 0 || scan.count <= 0)
+            return {};
+
+        const int count = scan.count;
+        const int bands = static_cast<int>(std::clamp<long long>(
+            static_cast<long long>(w) * h / MIN_BAND_PIXELS, 1,
+            std::min(m_thread_count, h)));
+        std::vector<Sum> acc(static_cast<std::size_t>(bands) * count);
+
+        with_layout<Alpha::SKIP_TRANSPARENT>([&](auto layout)
+        {
+            using L = decltype(layout);
+            const float *data = m_img.data.data();
+            const double ux   = scan.ux;
+
+            run_chunks(bands, h, [&](int c, int begin, int end)
+            {
+                Sum *a = acc.data() + static_cast<std::size_t>(c) * count;
+                for (int i = begin; i < end && !cancelled(); ++i)
+                {
+                    const int    y   = y0 + i;
+                    const float *row = data + static_cast<std::size_t>(y) * m_img.stride;
+                    // Strip of pixel x is floor(x * ux + off); the argument
+                    // is >= 0 but for rounding, so truncation floors it
+                    const double off = static_cast<double>(y) * scan.uy - scan.first + 0.5;
+                    if (std::abs(ux) * SHORT_RUN > 1.0)
+                    {
+                        // Runs too short to sum as blocks: add pixel by pixel
+                        const float fux  = scan.ux;
+                        const float foff = static_cast<float>(off);
+                        for (int x = x0; x < x1; ++x)
+                        {
+                            const int k = std::min(static_cast<int>(static_cast<float>(x) * fux + foff),
+                                                   count - 1);
+                            const float *p  = row + static_cast<std::size_t>(x) * L::CHANNELS;
+                            const float  wt = L::weight(p);
+                            Sum &s = a[std::max(0, k)];
+                            s.r += wt * L::r(p);
+                            s.g += wt * L::g(p);
+                            s.b += wt * L::b(p);
+                            s.n += wt;
+                        }
+                        continue;
+                    }
+                    for (int x = x0; x < x1;)
+                    {
+                        const int k = std::clamp(static_cast<int>(x * ux + off), 0, count - 1);
+                        // First pixel past strip k
+                        double stop = x1;
+                        if (ux > 0.0)
+                            stop = std::ceil((k + 1 - off) / ux);
+                        else if (ux < 0.0)
+                            stop = std::floor((k - off) / ux) + 1.0;
+                        const int next = static_cast<int>(
+                            std::clamp(stop, static_cast<double>(x + 1), static_cast<double>(x1)));
+
+                        const Sum run = sum_run<L>(row + static_cast<std::size_t>(x) * L::CHANNELS,
+                                                   next - x, L::CHANNELS);
+                        Sum &s = a[k];
+                        s.r += run.r;
+                        s.g += run.g;
+                        s.b += run.b;
+                        s.n += run.n;
+                        x = next;
+                    }
+                }
+            });
+        });
+
+        std::vector<StripData> out(static_cast<std::size_t>(count));
+        for (int k = 0; k < count; ++k)
+        {
+            Sum s;
+            for (int c = 0; c < bands; ++c)
+            {
+                const Sum &part = acc[static_cast<std::size_t>(c) * count + k];
+                s.r += part.r;
+                s.g += part.g;
+                s.b += part.b;
+                s.n += part.n;
+            }
+            out[static_cast<std::size_t>(k)] = s.mean();
+        }
+        return out;
+    }
+
+    struct Strip
+    {
+        StripData d;
+        int x, y;
+    };
+
+    // Where the output of render_strips() sits in a longer stream (frame
+    // sequences): phase and index of its first strip, the stream's strip
+    // count and the size of the frame. All zero for a standalone render.
+    struct StreamPos
+    {
+        std::uint64_t phase = 0;
+        int first_strip     = 0;
+        int total_strips    = 0;
+        int width = 0, height = 0;
+    };
+    // Change of a strip's colour since the previous frame of a sequence
+    struct StripDelta
+    {
+        float brightness = 0.f, r = 0.f, g = 0.f, b = 0.f;
+    };
+
+    // One frame as the reduce stage of sonify_frames() hands it on
+    struct ReducedFrame
+    {
+        std::vector<Strip> strips;
+        std::vector<StripDelta> delta;
+        int width = 0, height = 0;
+    };
+
+    StreamPos m_stream;
+    // Deltas of the strips being rendered, indexed from
+    // m_stream.first_strip; null outside sequences
+    const StripDelta *m_delta = nullptr;
+    // When set, render_strips() only collects its strips here (the reduce
+    // stage of sonify_frames())
+    std::vector<Strip> *m_collect = nullptr;
+
+    // Side of the square tiles consecutive frames are compared in
+    static constexpr int DELTA_TILE = 64;
+
+    // What the reduce stage of sonify_frames() keeps from the previous frame
+    struct DeltaState
+    {
+        std::vector<float> prev; // its pixels
+        Bounds bounds{};         // and the bounds it was reduced in
+        int stride = 0;
+        std::vector<Strip> strips;
+        int tiles_x = 0, tiles_y = 0;
+        std::vector<std::uint8_t> dirty; // tiles that differ from prev
+        // Per-column sums of each tile row (column directions) or per-row
+        // sums of each tile column (row directions), r, g, b, n quadruples
+        std::vector<float> parts;
+    };
+
+    // Reduces the current image to strips, redoing only what changed since
+    // the frame `st` holds: a frame equal to it reuses its strips outright,
+    // and the column/row directions re-sum only the tiles that differ. The
+    // other directions reduce changed frames in full.
+    void reduce_frame(DeltaState &st, ReducedFrame &out)
+    {
+        const Bounds bb  = effective_bounds();
+        const int w      = bb.x1 - bb.x0, h = bb.y1 - bb.y0;
+        const bool fresh = st.strips.empty() || st.prev.size() != m_img.data.size()
+                           || st.stride != m_img.stride || st.bounds.x0 != bb.x0
+                           || st.bounds.y0 != bb.y0 || st.bounds.x1 != bb.x1
+                           || st.bounds.y1 != bb.y1;
+
+        st.tiles_x = (std::max(w, 0) + DELTA_TILE - 1) / DELTA_TILE;
+        st.tiles_y = (std::max(h, 0) + DELTA_TILE - 1) / DELTA_TILE;
+        st.dirty.assign(static_cast<std::size_t>(st.tiles_x) * st.tiles_y, fresh);
+        if (!fresh)
+            mark_dirty_tiles(st, bb);
+
+        const bool changed = std::ranges::find(st.dirty, 1) != st.dirty.end();
+        switch (m_direction)
         {
-            const float *px = &m_img.data[y * m_img.stride + x * m_img.channels];
-            if (m_img.channels >= 4 && px[3] < 0.5f)
+            case Direction::LEFT_TO_RIGHT:
+            case Direction::RIGHT_TO_LEFT:
+            case Direction::TOP_TO_BOTTOM:
+            case Direction::BOTTOM_TO_TOP:
+                out.strips = st.strips;
+                if (changed)
+                    reduce_tiles(st, bb, fresh, out.strips);
+                break;
+            default:
+                if (changed)
+                {
+                    m_collect = &out.strips;
+                    sonify_direction();
+                    m_collect = nullptr;
+                }
+                else
+                    out.strips = st.strips;
+        }
+
+        out.delta.assign(out.strips.size(), {});
+        if (!fresh && changed && out.strips.size() == st.strips.size())
+            for (std::size_t i = 0; i < out.strips.size(); ++i)
+            {
+                const StripData &a = st.strips[i].d, &b = out.strips[i].d;
+                out.delta[i] = {b.brightness - a.brightness, b.r - a.r,
+                                b.g - a.g, b.b - a.b};
+            }
+
+        st.strips = out.strips;
+        st.bounds = bb;
+        st.stride = m_img.stride;
+        // The image is replaced by the next frame, so keep it rather than copy
+        std::swap(st.prev, m_img.data);
+    }
+
+    // Flags the tiles of the bounds whose pixels differ from st.prev, one
+    // tile row per task. Rows are compared a tile wide with memcmp, which
+    // runs vectorized, and a tile stops being compared at its first change.
+    void mark_dirty_tiles(DeltaState &st, const Bounds &bb)
+    {
+        const std::size_t ch   = static_cast<std::size_t>(m_img.channels);
+        const std::size_t span = static_cast<std::size_t>(m_img.stride);
+        const float *cur = m_img.data.data(), *prev = st.prev.data();
+        run_chunks(std::clamp(m_thread_count, 1, std::max(st.tiles_y, 1)), st.tiles_y,
+                   [&](int, int begin, int end)
+        {
+            for (int ty = begin; ty < end && !cancelled(); ++ty)
+            {
+                const int ya = bb.y0 + ty * DELTA_TILE;
+                const int yb = std::min(bb.y1, ya + DELTA_TILE);
+                for (int tx = 0; tx < st.tiles_x; ++tx)
+                {
+                    const int xa = bb.x0 + tx * DELTA_TILE;
+                    const std::size_t bytes
+                        = (std::min(bb.x1, xa + DELTA_TILE) - xa) * ch * sizeof(float);
+                    for (int y = ya; y < yb; ++y)
+                    {
+                        const std::size_t at = y * span + xa * ch;
+                        if (std::memcmp(cur + at, prev + at, bytes) != 0)
+                        {
+                            st.dirty[static_cast<std::size_t>(ty) * st.tiles_x + tx] = 1;
+                            break;
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // Column/row directions: re-sums the dirty tiles into st.parts, then
+    // rebuilds the strips of every column (row) crossing one from the
+    // partial sums of its tiles. `strips` holds the previous frame's.
+    void reduce_tiles(DeltaState &st, const Bounds &bb, bool fresh,
+                      std::vector<Strip> &strips)
+    {
+        const auto [x0, y0, x1, y1] = bb;
+        const int w = x1 - x0, h = y1 - y0;
+        const bool columns = m_direction == Direction::LEFT_TO_RIGHT
+                             || m_direction == Direction::RIGHT_TO_LEFT;
+        // parts[tile][i]: column i of tile row `tile`, or row i of tile column
+        const int line = columns ? w : h;
+        const int n_parts = columns ? st.tiles_y : st.tiles_x;
+        if (fresh)
+        {
+            st.parts.assign(static_cast<std::size_t>(n_parts) * line * 4, 0.0f);
+            strips.assign(static_cast<std::size_t>(line), Strip{});
+        }
+        auto part = [&](int tile, int i)
+        {
+            return st.parts.data() + (static_cast<std::size_t>(tile) * line + i) * 4;
+        };
+
+        with_layout<Alpha::SKIP_TRANSPARENT>([&](auto layout)
+        {
+            using L = decltype(layout);
+            const float *data = m_img.data.data();
+            run_chunks(std::clamp(m_thread_count, 1, std::max(st.tiles_y, 1)), st.tiles_y,
+                       [&](int, int begin, int end)
+            {
+                for (int ty = begin; ty < end && !cancelled(); ++ty)
+                    for (int tx = 0; tx < st.tiles_x; ++tx)
+                    {
+                        if (!st.dirty[static_cast<std::size_t>(ty) * st.tiles_x + tx])
+                            continue;
+                        const int xa = tx * DELTA_TILE, xn = std::min(w - xa, DELTA_TILE);
+                        const int ya = ty * DELTA_TILE, yb = std::min(h, ya + DELTA_TILE);
+                        if (columns)
+                            std::fill_n(part(ty, xa), 4 * xn, 0.0f);
+                        for (int y = ya; y < yb; ++y)
+                        {
+                            const float *row = data
+                                               + static_cast<std::size_t>(y0 + y) * m_img.stride
+                                               + static_cast<std::size_t>(x0 + xa) * L::CHANNELS;
+                            if (columns)
+                                add_row<L>(row, part(ty, xa), xn);
+                            else
+                            {
+                                const Sum s = sum_run<L>(row, xn, L::CHANNELS);
+                                float *p    = part(tx, y);
+                                p[0] = s.r;
+                                p[1] = s.g;
+                                p[2] = s.b;
+                                p[3] = s.n;
+                            }
+                        }
+                    }
+            });
+        });
+        if (cancelled())
+            return;
+
+        // Lines crossing a dirty tile
+        const int tiles_along = columns ? st.tiles_x : st.tiles_y;
+        for (int t = 0; t < tiles_along; ++t)
+        {
+            bool dirty = false;
+            for (int u = 0; u < n_parts && !dirty; ++u)
+                dirty = columns ? st.dirty[static_cast<std::size_t>(u) * st.tiles_x + t]
+                                : st.dirty[static_cast<std::size_t>(t) * st.tiles_x + u];
+            if (!dirty)
                 continue;
-            sr += px[0];
-            sg += (m_img.channels >= 3) ? px[1] : px[0];
-            sb += (m_img.channels >= 3) ? px[2] : px[0];
-            ++count;
+            for (int i = t * DELTA_TILE; i < std::min(line, (t + 1) * DELTA_TILE); ++i)
+            {
+                Sum s;
+                for (int u = 0; u < n_parts; ++u)
+                {
+                    const float *p = part(u, i);
+                    s.r += p[0];
+                    s.g += p[1];
+                    s.b += p[2];
+                    s.n += p[3];
+                }
+                switch (m_direction)
+                {
+                    case Direction::LEFT_TO_RIGHT:
+                        strips[static_cast<std::size_t>(i)] = {s.mean(), x0 + i, y0};
+                        break;
+                    case Direction::RIGHT_TO_LEFT:
+                        strips[static_cast<std::size_t>(w - 1 - i)] = {s.mean(), x0 + i, y0};
+                        break;
+                    case Direction::TOP_TO_BOTTOM:
+                        strips[static_cast<std::size_t>(i)] = {s.mean(), x0, y0 + i};
+                        break;
+                    default:
+                        strips[static_cast<std::size_t>(h - 1 - i)] = {s.mean(), x0, y0 + i};
+                }
+            }
         }
-        if (count == 0)
-            return make_strip_data(0.f, 0.f, 0.f);
-        const float n = static_cast<float>(count);
-        return make_strip_data(sr / n, sg / n, sb / n);
     }
 
-    void emit_strip(const StripData &d, int x, int y, int w, int h, int spu,
-                    int strip_index, int strip_count)
+    inline int samples_per_unit() const noexcept
     {
+        return std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
+    }
+
+    // Phase an oscillator following the frequency map advances over strip
+    // `s` (spu samples). Must match what sonify_functions::sine() computes.
+    std::uint64_t phase_advance(const Strip &s, int spu) const noexcept
+    {
+        const float b    = std::clamp(s.d.brightness, 0.0f, 1.0f);
+        const float freq = map_frequency(b, m_freq_map.scale, m_freq_map.min,
+                                         m_freq_map.max);
+        return phase_increment(freq, m_sample_rate)
+               * static_cast<std::uint64_t>(spu);
+    }
+
+    void emit_strip(const SonifyFunc &func, std::vector<float> &out,
+                    const Strip &s, int spu, int strip_index, int strip_count,
+                    int chunk_start, std::uint64_t phase) const
+    {
+        const StripData &d = s.d;
+        const StripDelta dl
+            = m_delta ? m_delta[strip_index - m_stream.first_strip] : StripDelta{};
         SonifyContext ctx{
             .sample_rate   = m_sample_rate,
             .brightness    = d.brightness,
@@ -367,171 +1526,1195 @@ private:
             .h             = d.h,
             .s             = d.s,
             .v             = d.v,
-            .x             = x,
-            .y             = y,
-            .width         = w,
-            .height        = h,
+            .delta         = dl.brightness,
+            .dr            = dl.r,
+            .dg            = dl.g,
+            .db            = dl.b,
+            .x             = static_cast<int>(std::floor((s.x + 0.5) * m_source_sx)),
+            .y             = static_cast<int>(std::floor((s.y + 0.5) * m_source_sy)),
+            .width         = static_cast<int>(std::lround(
+                (m_stream.width ? m_stream.width : m_img.width) * m_source_sx)),
+            .height        = static_cast<int>(std::lround(
+                (m_stream.width ? m_stream.height : m_img.height) * m_source_sy)),
             .strip_index   = strip_index,
             .strip_count   = strip_count,
-            .t             = static_cast<float>(m_audio_data.size())
-                             / (m_sample_rate * m_channel_count),
+            .chunk_start   = chunk_start,
+            .render_id     = m_render_id,
+            .t             = static_cast<float>(static_cast<double>(strip_index)
+                                                * spu / m_sample_rate),
+            .phase         = phase,
             .n_samples     = spu,
             .channel_count = m_channel_count,
             .freq_scale    = m_freq_map.scale,
             .fmin          = m_freq_map.min,
             .fmax          = m_freq_map.max,
         };
-        m_sonify_func(ctx, m_audio_data);
+        func(ctx, out);
     }
 
-    void sonify_left_to_right()
+    // Wraps a per-index strip generator as a range producer for
+    // render_strips().
+    template <typename StripAt>
+    static auto indexed(StripAt strip_at)
     {
-        const int w   = m_img.width;
-        const int h   = m_img.height;
-        const int spu = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
-        const auto [x0, y0, x1, y1] = effective_bounds();
-        const int count = x1 - x0;
+        return [strip_at](int begin, int end, auto &&sink)
+        {
+            for (int i = begin; i < end; ++i)
+                sink(i, strip_at(i));
+        };
+    }
+
+    // Strips between cancellation checks that skip the strip producer too;
+    // individual strips are always checked before their sonify function runs.
+    static constexpr int CANCEL_BLOCK = 64;
+
+    // Calls for_range over [begin, end) in blocks, stopping early once the
+    // render is cancelled. `sink` is skipped for cancelled strips and counts
+    // completed ones towards progress().
+    template <typename ForRange, typename Sink>
+    void for_blocks(ForRange &for_range, int begin, int end, Sink &&sink)
+    {
+        for (int b = begin; b < end && !cancelled(); b += CANCEL_BLOCK)
+        {
+            for_range(b, std::min(b + CANCEL_BLOCK, end),
+                      [&](int i, const Strip &s)
+            {
+                if (cancelled())
+                    return;
+                sink(i, s);
+                m_strips_done.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+    }
+
+    // Splits [0, count) into n_chunks contiguous ranges and runs
+    // fn(c, begin, end) for each on its own thread. If one throws, the others
+    // are cancelled and waited for before rethrowing, rather than left
+    // running while the future destructors block.
+    template <typename Fn>
+    void run_chunks(int n_chunks, int count, Fn &&fn)
+    {
+        auto chunk_begin = [count, n_chunks](int c)
+        {
+            return static_cast<int>(static_cast<long long>(count) * c / n_chunks);
+        };
+
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(n_chunks);
+        for (int c = 0; c < n_chunks; ++c)
+            jobs.push_back(std::async(std::launch::async, [&, c]
+            { fn(c, chunk_begin(c), chunk_begin(c + 1)); }));
+        try
+        {
+            for (auto &job : jobs)
+                job.get();
+        }
+        catch (...)
+        {
+            cancel();
+            for (auto &job : jobs)
+                if (job.valid())
+                    job.wait();
+            m_audio_data.clear();
+            throw;
+        }
+    }
+
+    // Parallel chunks are only worth their threads above this many samples
+    // each (applies to thread-safe sonify functions; worker funcs always
+    // get one chunk per worker).
+    static constexpr std::size_t MIN_CHUNK_SAMPLES = 1 << 16;
+    // Strips kept between the two parallel passes; beyond this the strip
+    // producer is run twice instead.
+    static constexpr int MAX_CACHED_STRIPS = 1 << 16;
+    // Memo entry of a strip that rendered all zeros
+    static constexpr std::size_t SILENT = static_cast<std::size_t>(-1);
+
+    // Memo key: r, g and b quantized to m_memo_levels, 16 bits each
+    std::uint64_t memo_key(const StripData &d) const noexcept
+    {
+        const float q = static_cast<float>(m_memo_levels - 1);
+        auto level = [q](float c)
+        { return static_cast<std::uint64_t>(std::clamp(c, 0.0f, 1.0f) * q + 0.5f); };
+        return level(d.r) | level(d.g) << 16 | level(d.b) << 32;
+    }
+
+    // Runs for_range over [0, count) into *m_collect, in parallel chunks
+    template <typename ForRange>
+    void collect_strips(int count, ForRange &for_range)
+    {
+        m_collect->assign(static_cast<std::size_t>(count), Strip{});
+        const int n_chunks = std::clamp(count / CANCEL_BLOCK, 1, m_thread_count);
+        run_chunks(n_chunks, count, [&](int, int begin, int end)
+        {
+            for (int b = begin; b < end && !cancelled(); b += CANCEL_BLOCK)
+                for_range(b, std::min(b + CANCEL_BLOCK, end), [&](int i, const Strip &s)
+                {
+                    (*m_collect)[static_cast<std::size_t>(i)] = s;
+                });
+        });
+    }
+
+    // render_strips() with an audio sink: collects the strips a block at a
+    // time, renders each block as a stretch of the stream (see StreamPos)
+    // and passes its audio on, so the output matches a single render.
+    template <typename ForRange>
+    void stream_strips(int count, ForRange &for_range, const SonifyFunc *builtin)
+    {
+        const StreamPos outer         = m_stream;
+        const StripDelta *outer_delta = m_delta;
+
+        const int spu = samples_per_unit();
+        const std::size_t strip_len = static_cast<std::size_t>(spu) * m_channel_count;
+        const int block = static_cast<int>(std::clamp<std::size_t>(
+            MIN_CHUNK_SAMPLES * m_thread_count / strip_len, 1, MAX_CACHED_STRIPS));
+        if (m_stream.total_strips <= 0)
+            m_stream.total_strips = count;
+
+        auto restore = [&]
+        {
+            m_collect = nullptr;
+            m_stream  = outer;
+            m_delta   = outer_delta;
+        };
+
+        std::vector<Strip> strips;
+        try
+        {
+            for (int b = 0; b < count && !cancelled(); b += block)
+            {
+                const int n = std::min(block, count - b);
+                auto window = [&](int begin, int end, auto &&out)
+                {
+                    for_range(b + begin, b + end, [&](int i, const Strip &s)
+                    { out(i - b, s); });
+                };
+                m_collect = &strips;
+                collect_strips(n, window);
+                m_collect = nullptr;
+                m_delta   = outer_delta ? outer_delta + b : nullptr;
+                auto cached = [&](int begin, int end, auto &&out)
+                {
+                    for (int i = begin; i < end; ++i)
+                        out(i, strips[static_cast<std::size_t>(i)]);
+                };
+                render_block(n, cached, builtin);
+                if (cancelled())
+                    break;
+
+                for (const Strip &s : strips)
+                    m_stream.phase += phase_advance(s, spu);
+                m_stream.first_strip += n;
+                m_audio_sink(m_audio_data);
+            }
+        }
+        catch (...)
+        {
+            restore();
+            throw;
+        }
+        restore();
         m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(count) * spu * m_channel_count);
-        for (int i = 0; i < count; ++i)
-            emit_strip(column_data(x0 + i, y0, y1), x0 + i, y0, w, h, spu, i, count);
     }
 
-    void sonify_right_to_left()
+    // Renders `count` strips into m_audio_data. `for_range(begin, end, sink)`
+    // must call sink(i, Strip) for every i in [begin, end) in order, and be
+    // safe to call concurrently on disjoint ranges. m_audio_data is left
+    // empty if the render is cancelled. `builtin`, if given, is a thread-safe
+    // engine function used instead of sonify_func() and the worker funcs.
+    //
+    // In parallel the strips are split into contiguous chunks and rendered
+    // in two passes: the first sums each chunk's phase advance, an exclusive
+    // scan over those sums gives every chunk its exact starting phase, and
+    // the second renders. The output is identical to a serial render. With
+    // an audio sink set, stream_strips() renders it in blocks instead.
+    template <typename ForRange>
+    void render_strips(int count, ForRange &&for_range,
+                       const SonifyFunc *builtin = nullptr)
     {
-        const int w   = m_img.width;
-        const int h   = m_img.height;
-        const int spu = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
-        const auto [x0, y0, x1, y1] = effective_bounds();
-        const int count = x1 - x0;
+        if (m_collect)
+        {
+            collect_strips(count, for_range);
+            return;
+        }
+        if (m_audio_sink)
+            stream_strips(count, for_range, builtin);
+        else
+            render_block(count, for_range, builtin);
+    }
+
+    template <typename ForRange>
+    void render_block(int count, ForRange &for_range, const SonifyFunc *builtin)
+    {
+        const int spu = samples_per_unit();
+        const std::size_t strip_len = static_cast<std::size_t>(spu) * m_channel_count;
+        const int first = m_stream.first_strip;
+        const int total = m_stream.total_strips > 0 ? m_stream.total_strips : count;
+
         m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(count) * spu * m_channel_count);
-        for (int i = 0; i < count; ++i)
-            emit_strip(column_data(x1 - 1 - i, y0, y1), x1 - 1 - i, y0, w, h, spu, i, count);
+        m_strips_total.store(total, std::memory_order_relaxed);
+        float *target = nullptr;
+        if (m_audio_target && !m_audio_sink)
+            target = m_audio_target(static_cast<std::size_t>(count) * strip_len);
+
+        const SonifyFunc &main_func = builtin ? *builtin
+                                      : !m_worker_funcs.empty() ? m_worker_funcs.front()
+                                                                : m_sonify_func;
+        const bool use_workers = !builtin && m_worker_funcs.size() > 1;
+        const bool memoize     = !builtin && m_memo_levels > 0;
+        int n_chunks = 1;
+        if (use_workers)
+            n_chunks = std::min(static_cast<int>(m_worker_funcs.size()), count);
+        else if (builtin || m_sonify_func_thread_safe)
+            n_chunks = static_cast<int>(std::clamp<std::size_t>(
+                static_cast<std::size_t>(count) * strip_len / MIN_CHUNK_SAMPLES,
+                1, static_cast<std::size_t>(m_thread_count)));
+
+        // Memoized renders and audio targets take the chunked path even on
+        // one thread: it writes every strip at a fixed offset, so a repeat
+        // can copy an earlier one.
+        if (n_chunks > 1 || memoize || target)
+        {
+            float *out = target;
+            if (!out)
+            {
+                m_audio_data.resize(static_cast<std::size_t>(count) * strip_len, 0.0f);
+                out = m_audio_data.data();
+            }
+
+            // Pass 1: phase advance of each chunk, then exclusive scan. Strips
+            // are kept for pass 2 unless there are too many (traversals),
+            // in which case the producer runs again.
+            std::vector<Strip> strips;
+            if (count <= MAX_CACHED_STRIPS)
+                strips.resize(static_cast<std::size_t>(count));
+            std::vector<std::uint64_t> chunk_phase(n_chunks, 0);
+            run_chunks(n_chunks, count, [&](int c, int begin, int end)
+            {
+                std::uint64_t advance = 0;
+                for_range(begin, end, [&](int i, const Strip &s)
+                {
+                    advance += phase_advance(s, spu);
+                    if (!strips.empty())
+                        strips[static_cast<std::size_t>(i)] = s;
+                });
+                chunk_phase[c] = advance;
+            });
+            std::uint64_t phase = m_stream.phase;
+            for (auto &p : chunk_phase)
+                p = std::exchange(phase, phase + p);
+
+            // Pass 2: render
+            run_chunks(n_chunks, count, [&](int c, int begin, int end)
+            {
+                const SonifyFunc &func = use_workers ? m_worker_funcs[c] : main_func;
+                std::uint64_t phase = chunk_phase[c];
+                std::vector<float> buf;
+                buf.reserve(strip_len);
+                // Quantized colour -> offset of its first strip, or SILENT
+                std::unordered_map<std::uint64_t, std::size_t> memo;
+                auto replay = [&](int b, int e, auto &&sink)
+                {
+                    for (int i = b; i < e; ++i)
+                        sink(i, strips[static_cast<std::size_t>(i)]);
+                };
+                auto render = [&](int i, const Strip &s)
+                {
+                    const std::size_t offset = static_cast<std::size_t>(i) * strip_len;
+                    std::size_t *memo_slot   = nullptr;
+                    if (memoize)
+                    {
+                        const auto [it, fresh] = memo.try_emplace(memo_key(s.d), SILENT);
+                        if (!fresh)
+                        {
+                            // The output is zero-filled, so silence is free
+                            if (it->second != SILENT)
+                                std::copy_n(out + it->second, strip_len, out + offset);
+                            phase += phase_advance(s, spu);
+                            return;
+                        }
+                        memo_slot = &it->second;
+                    }
+
+                    buf.clear();
+                    emit_strip(func, buf, s, spu, first + i, total, first + begin, phase);
+                    phase += phase_advance(s, spu);
+                    buf.resize(strip_len, 0.0f);
+                    std::copy(buf.begin(), buf.end(), out + offset);
+                    if (memo_slot
+                        && std::any_of(buf.begin(), buf.end(), [](float v) { return v != 0.0f; }))
+                        *memo_slot = offset;
+                };
+                if (strips.empty())
+                    for_blocks(for_range, begin, end, render);
+                else
+                    for_blocks(replay, begin, end, render);
+            });
+        }
+        else
+        {
+            m_audio_data.reserve(static_cast<std::size_t>(count) * strip_len);
+            std::uint64_t phase = m_stream.phase;
+            for_blocks(for_range, 0, count, [&](int i, const Strip &s)
+            {
+                emit_strip(main_func, m_audio_data, s, spu, first + i, total, first, phase);
+                phase += phase_advance(s, spu);
+            });
+        }
+
+        if (cancelled())
+        {
+            m_audio_data.clear();
+            m_audio_data.shrink_to_fit();
+        }
     }
 
-    void sonify_top_to_bottom()
+    void sonify_left_to_right(const SonifyFunc *builtin = nullptr)
     {
-        const int w   = m_img.width;
-        const int h   = m_img.height;
-        const int spu = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
         const auto [x0, y0, x1, y1] = effective_bounds();
-        const int count = y1 - y0;
-        m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(count) * spu * m_channel_count);
-        for (int i = 0; i < count; ++i)
-            emit_strip(row_data(y0 + i, x0, x1), x0, y0 + i, w, h, spu, i, count);
+        const std::vector<StripData> cols = frame_data(true);
+        render_strips(x1 - x0, indexed([&, x0, y0](int i)
+        {
+            return Strip{cols[static_cast<std::size_t>(i)], x0 + i, y0};
+        }), builtin);
     }
 
-    void sonify_bottom_to_top()
+    void sonify_right_to_left(const SonifyFunc *builtin = nullptr)
     {
-        const int w   = m_img.width;
-        const int h   = m_img.height;
-        const int spu = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
         const auto [x0, y0, x1, y1] = effective_bounds();
-        const int count = y1 - y0;
-        m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(count) * spu * m_channel_count);
-        for (int i = 0; i < count; ++i)
-            emit_strip(row_data(y1 - 1 - i, x0, x1), x0, y1 - 1 - i, w, h, spu, i, count);
+        const std::vector<StripData> cols = frame_data(true);
+        const int w = x1 - x0;
+        render_strips(w, indexed([&, y0, x1, w](int i)
+        {
+            return Strip{cols[static_cast<std::size_t>(w - 1 - i)], x1 - 1 - i, y0};
+        }), builtin);
     }
 
-    // Shared implementation for ROTATE_CW (clockwise=true) and ROTATE_CCW.
-    // Sweeps radial lines from the image centre, one strip per angle step.
-    // Brightness of each strip = average brightness along that ray.
-    // ctx.x / ctx.y = tip pixel of the ray (last in-bounds sample).
-    void sonify_rotate(bool clockwise)
+    void sonify_top_to_bottom(const SonifyFunc *builtin = nullptr)
     {
-        const int   w    = m_img.width;
-        const int   h    = m_img.height;
-        const int   spu  = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
-        const float cx   = (w - 1) * 0.5f;
-        const float cy   = (h - 1) * 0.5f;
-        const int   num_strips = std::max(w, h);
-        const int   max_steps  = static_cast<int>(std::sqrt(cx * cx + cy * cy)) + 2;
-        constexpr float two_pi = 6.28318530718f;
+        const auto [x0, y0, x1, y1] = effective_bounds();
+        const std::vector<StripData> rows = frame_data(false);
+        render_strips(y1 - y0, indexed([&, x0, y0](int i)
+        {
+            return Strip{rows[static_cast<std::size_t>(i)], x0, y0 + i};
+        }), builtin);
+    }
 
-        m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(num_strips) * spu * m_channel_count);
+    void sonify_bottom_to_top(const SonifyFunc *builtin = nullptr)
+    {
+        const auto [x0, y0, x1, y1] = effective_bounds();
+        const std::vector<StripData> rows = frame_data(false);
+        const int h = y1 - y0;
+        render_strips(h, indexed([&, x0, y1, h](int i)
+        {
+            return Strip{rows[static_cast<std::size_t>(h - 1 - i)], x0, y1 - 1 - i};
+        }), builtin);
+    }
+
+    // Straight scan at scan_angle(): one strip per pixel of the bounds'
+    // extent along the scan direction, each the mean of the pixels on its
+    // line (see AngleScan), read straight from the unrotated image.
+    // ctx.x / ctx.y = where the line crosses the middle of the bounds,
+    // clamped to the bounds.
+    void sonify_angle()
+    {
+        const auto [x0, y0, x1, y1] = effective_bounds();
+        const AngleScan scan = angle_scan();
+        const std::vector<StripData> lines = angle_data(scan);
+        render_strips(static_cast<int>(lines.size()), indexed([&](int i)
+        {
+            const auto [x, y] = scan.centre(i);
+            return Strip{lines[static_cast<std::size_t>(i)],
+                         std::clamp(static_cast<int>(std::round(x)), x0, x1 - 1),
+                         std::clamp(static_cast<int>(std::round(y)), y0, y1 - 1)};
+        }));
+    }
+
+    // Radial reductions of the image within the bounds: rays for the rotate
+    // directions, rings for the circle ones. Each is built on first use and
+    // cached per image and bounds, so re-sonifying with other audio settings
+    // skips it and a direction never pays for the other's.
+    //
+    // Rotate strip i averages a wedge of rays centred on angle i / strips of
+    // a turn, clockwise from 12 o'clock, each sampled at unit steps from the
+    // centre until it first leaves the bounds. There are enough rays per
+    // wedge to give the outermost ring a sample per pixel; nearer the centre,
+    // where the wedge is narrower, fewer of them are sampled. Each ray costs
+    // one sin/cos and its length is solved up front, not tested per step.
+    //
+    // Ring r averages the pixels at distance [r, r + 1) from the centre. Each
+    // row is walked outwards from the centre column, so the radius only ever
+    // grows and is tracked by comparing squares instead of a square root per
+    // pixel.
+    struct Polar
+    {
+        std::vector<Strip>     rays;  // rotate strips, clockwise
+        std::vector<StripData> rings; // circle strips, by radius
+    };
+    struct PolarKey
+    {
+        std::uint64_t version;
+        int x0, y0, x1, y1;
+        bool operator==(const PolarKey &) const = default;
+    };
+    Polar    m_polar;
+    PolarKey m_rays_key{};
+    PolarKey m_rings_key{};
+
+    PolarKey polar_key() const noexcept
+    {
+        const Bounds bounds = effective_bounds();
+        return PolarKey{m_image_version, bounds.x0, bounds.y0, bounds.x1, bounds.y1};
+    }
+
+    // Largest ring radius of the image, whatever the bounds
+    int polar_max_radius() const noexcept
+    {
+        const float cx = (m_img.width - 1) * 0.5f;
+        const float cy = (m_img.height - 1) * 0.5f;
+        return static_cast<int>(std::sqrt(cx * cx + cy * cy)) + 1;
+    }
+
+    const std::vector<Strip> &polar_rays()
+    {
+        const PolarKey key = polar_key();
+        if (key == m_rays_key && !m_polar.rays.empty())
+            return m_polar.rays;
 
+        constexpr float two_pi = 6.28318530718f;
+        const int   w      = m_img.width;
+        const int   h      = m_img.height;
+        const float cx     = (w - 1) * 0.5f;
+        const float cy     = (h - 1) * 0.5f;
+        const int   strips = std::max(w, h);
+        const int   max_r  = polar_max_radius();
+        const int   per_strip = std::max(1, static_cast<int>(
+                                    std::ceil(two_pi * max_r / strips)));
+        const int   rays   = strips * per_strip;
         const auto [bx0, by0, bx1, by1] = effective_bounds();
+        // In bounds iff the nearest pixel is
+        const float lo_x = bx0 - 0.5f, hi_x = bx1 - 0.5f;
+        const float lo_y = by0 - 0.5f, hi_y = by1 - 0.5f;
 
-        for (int i = 0; i < num_strips; ++i)
+        std::vector<Strip> rays_out(static_cast<std::size_t>(strips));
+        with_layout<Alpha::IGNORE>([&](auto layout)
         {
-            const float angle = static_cast<float>(i) * two_pi
-                                / static_cast<float>(num_strips);
-            // CW from 12 o'clock: dx=sin, dy=-cos
-            // CCW from 12 o'clock: dx=-sin, dy=-cos
-            const float dx = clockwise ? std::sin(angle) : -std::sin(angle);
-            const float dy = -std::cos(angle);
+            using L = decltype(layout);
+            auto at = [&](int x, int y)
+            { return &m_img.data[y * m_img.stride + x * L::CHANNELS]; };
+
+            // Steps (from 0) a ray takes before it first leaves the bounds;
+            // solved per axis, then settled on the per-step test so float
+            // rounding cannot move the edge
+            auto inside = [&](float x, float y, int step)
+            {
+                const float px = cx + x * static_cast<float>(step);
+                const float py = cy + y * static_cast<float>(step);
+                return px > lo_x && px < hi_x && py > lo_y && py < hi_y;
+            };
+            auto ray_steps = [&](float x, float y)
+            {
+                if (!inside(x, y, 0))
+                    return 0;
+                float bound = static_cast<float>(max_r + 1);
+                if (x != 0.0f)
+                    bound = std::min(bound, ((x > 0.0f ? hi_x : lo_x) - cx) / x);
+                if (y != 0.0f)
+                    bound = std::min(bound, ((y > 0.0f ? hi_y : lo_y) - cy) / y);
+                int n = std::clamp(static_cast<int>(std::ceil(bound)), 1, max_r + 1);
+                while (n > 1 && !inside(x, y, n - 1))
+                    --n;
+                while (n <= max_r && inside(x, y, n))
+                    ++n;
+                return n;
+            };
+
+            const int ray_chunks = static_cast<int>(std::clamp<long long>(
+                static_cast<long long>(rays) * max_r / MIN_BAND_PIXELS, 1,
+                std::min(m_thread_count, strips)));
+            run_chunks(ray_chunks, strips, [&](int, int begin, int end)
+            {
+                std::vector<float> dx(static_cast<std::size_t>(per_strip));
+                std::vector<float> dy(static_cast<std::size_t>(per_strip));
+                std::vector<int>   steps(static_cast<std::size_t>(per_strip));
+                for (int i = begin; i < end && !cancelled(); ++i)
+                {
+                    int longest = 0;
+                    for (std::size_t k = 0; k < steps.size(); ++k)
+                    {
+                        // Centred on the strip's angle
+                        const float angle = (static_cast<float>(i * per_strip) + static_cast<float>(k)
+                                             - 0.5f * static_cast<float>(per_strip - 1))
+                                            * two_pi / static_cast<float>(rays);
+                        dx[k]    = std::sin(angle);
+                        dy[k]    = -std::cos(angle);
+                        steps[k] = ray_steps(dx[k], dy[k]);
+                        longest  = std::max(longest, steps[k]);
+                    }
+
+                    Sum wedge;
+                    for (int step = 0; step < longest; ++step)
+                    {
+                        // The wedge is only about `span` pixels wide here, so
+                        // only that many of its rays (spread evenly) are
+                        // sampled, each standing in for its neighbours
+                        const float t      = static_cast<float>(step);
+                        const int   span   = std::min(per_strip,
+                                                 static_cast<int>(t * two_pi / static_cast<float>(strips)) + 1);
+                        const float weight = static_cast<float>(per_strip) / static_cast<float>(span);
+                        for (int s = 0; s < span; ++s)
+                        {
+                            const std::size_t k = static_cast<std::size_t>((2 * s + 1) * per_strip / (2 * span));
+                            if (step >= steps[k])
+                                continue;
+                            // px, py > -0.5, so this rounds to nearest
+                            const float *p = at(static_cast<int>(cx + dx[k] * t + 0.5f),
+                                                static_cast<int>(cy + dy[k] * t + 0.5f));
+                            wedge.r += weight * L::r(p);
+                            wedge.g += weight * L::g(p);
+                            wedge.b += weight * L::b(p);
+                            wedge.n += weight;
+                        }
+                    }
+
+                    // The tip is on the ray at the strip's own angle
+                    const float angle = static_cast<float>(i) * two_pi / static_cast<float>(strips);
+                    const float x     = std::sin(angle);
+                    const float y     = -std::cos(angle);
+                    const float tip   = static_cast<float>(std::max(0, ray_steps(x, y) - 1));
+                    rays_out[static_cast<std::size_t>(i)] = Strip{
+                        wedge.mean(),
+                        static_cast<int>(std::round(cx + x * tip)),
+                        static_cast<int>(std::round(cy + y * tip))};
+                }
+            });
+        });
+        // A cancelled build is incomplete; the render it feeds is dropped too
+        if (cancelled())
+            return m_polar.rays;
+        m_polar.rays = std::move(rays_out);
+        m_rays_key   = key;
+        return m_polar.rays;
+    }
+
+    const std::vector<StripData> &polar_rings()
+    {
+        const PolarKey key = polar_key();
+        if (key == m_rings_key && !m_polar.rings.empty())
+            return m_polar.rings;
+
+        const float cx    = (m_img.width - 1) * 0.5f;
+        const float cy    = (m_img.height - 1) * 0.5f;
+        const int   max_r = polar_max_radius();
+        const auto [bx0, by0, bx1, by1] = effective_bounds();
 
-            float sr = 0.f, sg = 0.f, sb = 0.f;
-            int   count = 0;
-            for (int step = 0; step <= max_steps; ++step)
+        std::vector<StripData> rings(static_cast<std::size_t>(max_r + 1));
+        with_layout<Alpha::IGNORE>([&](auto layout)
+        {
+            using L = decltype(layout);
+            auto at = [&](int x, int y)
+            { return &m_img.data[y * m_img.stride + x * L::CHANNELS]; };
+
+            const int rows = std::max(0, by1 - by0);
+            const int ring_chunks = static_cast<int>(std::clamp<long long>(
+                static_cast<long long>(bx1 - bx0) * rows / MIN_BAND_PIXELS, 1,
+                std::max(1, std::min(m_thread_count, rows))));
+            std::vector<Sum> ring_sums(static_cast<std::size_t>(ring_chunks) * (max_r + 1));
+            run_chunks(ring_chunks, rows, [&](int c, int begin, int end)
             {
-                const int ix = static_cast<int>(std::round(cx + dx * step));
-                const int iy = static_cast<int>(std::round(cy + dy * step));
-                if (ix < bx0 || ix >= bx1 || iy < by0 || iy >= by1)
-                    break;
-                const float *px = &m_img.data[iy * m_img.stride + ix * m_img.channels];
-                sr += px[0];
-                sg += (m_img.channels >= 3) ? px[1] : px[0];
-                sb += (m_img.channels >= 3) ? px[2] : px[0];
-                ++count;
+                Sum *acc = ring_sums.data() + static_cast<std::size_t>(c) * (max_r + 1);
+                for (int y = by0 + begin; y < by0 + end && !cancelled(); ++y)
+                {
+                    const float dy2 = (y - cy) * (y - cy);
+                    // Pixels from x away from the centre column up to stop,
+                    // summed in runs of equal radius
+                    auto walk = [&](int x, int stop, int dir)
+                    {
+                        if (x == stop)
+                            return;
+                        Sum run;
+                        int r = static_cast<int>(std::sqrt((x - cx) * (x - cx) + dy2));
+                        for (; x != stop; x += dir)
+                        {
+                            const float d2 = (x - cx) * (x - cx) + dy2;
+                            while (static_cast<float>((r + 1) * (r + 1)) <= d2)
+                            {
+                                Sum &ring = acc[r];
+                                ring.r += run.r;
+                                ring.g += run.g;
+                                ring.b += run.b;
+                                ring.n += run.n;
+                                run = Sum{};
+                                ++r;
+                            }
+                            const float *p = at(x, y);
+                            run.r += L::r(p);
+                            run.g += L::g(p);
+                            run.b += L::b(p);
+                            run.n += 1.0f;
+                        }
+                        Sum &ring = acc[r];
+                        ring.r += run.r;
+                        ring.g += run.g;
+                        ring.b += run.b;
+                        ring.n += run.n;
+                    };
+                    const int mid = std::clamp(static_cast<int>(std::ceil(cx)), bx0, bx1);
+                    walk(mid, bx1, 1);
+                    walk(mid - 1, bx0 - 1, -1);
+                }
+            });
+            for (int r = 0; r <= max_r; ++r)
+            {
+                Sum ring;
+                for (int c = 0; c < ring_chunks; ++c)
+                {
+                    const Sum &part = ring_sums[static_cast<std::size_t>(c) * (max_r + 1) + r];
+                    ring.r += part.r;
+                    ring.g += part.g;
+                    ring.b += part.b;
+                    ring.n += part.n;
+                }
+                rings[static_cast<std::size_t>(r)] = ring.mean();
             }
+        });
+        if (cancelled())
+            return m_polar.rings;
+        m_polar.rings = std::move(rings);
+        m_rings_key   = key;
+        return m_polar.rings;
+    }
 
-            const float n   = count > 0 ? static_cast<float>(count) : 1.f;
-            const int   tip = std::max(0, count - 1);
-            const int   tx  = static_cast<int>(std::round(cx + dx * tip));
-            const int   ty  = static_cast<int>(std::round(cy + dy * tip));
-            emit_strip(make_strip_data(sr / n, sg / n, sb / n), tx, ty, w, h, spu, i, num_strips);
-        }
+    // Shared implementation for ROTATE_CW (clockwise=true) and ROTATE_CCW.
+    // Sweeps radial lines from the image centre, one strip per angle step
+    // (max(width, height) per turn), each the average of its wedge of rays
+    // (see polar_rays()). ctx.x / ctx.y = tip pixel of the ray (last
+    // in-bounds sample).
+    void sonify_rotate(bool clockwise)
+    {
+        const std::vector<Strip> &rays = polar_rays();
+        const int n = static_cast<int>(rays.size());
+        // Counter-clockwise strip i is the clockwise ray at -i
+        render_strips(n, indexed([&, clockwise, n](int i)
+        {
+            return rays[static_cast<std::size_t>(clockwise ? i : (n - i) % n)];
+        }));
     }
 
     // Shared implementation for CIRCLE_OUTWARDS (outwards=true) and
     // CIRCLE_INWARDS (outwards=false). Pixels are bucketed by their integer
-    // distance from the image centre; each bucket becomes one audio strip.
-    // ctx.x carries the ring radius so custom sonify functions can use it.
+    // distance from the image centre (see polar_rings()); each bucket becomes one
+    // audio strip. ctx.x carries the ring radius so custom sonify functions
+    // can use it.
     void sonify_circle(bool outwards)
     {
-        const int w = m_img.width;
-        const int h = m_img.height;
-        const int spu = std::max(1, static_cast<int>(m_sample_rate * m_secs_per_unit));
+        const std::vector<StripData> &rings = polar_rings();
+        const int max_r = static_cast<int>(rings.size()) - 1;
+        render_strips(max_r + 1, indexed([&, outwards, max_r](int i)
+        {
+            const int r = outwards ? i : (max_r - i);
+            return Strip{rings[static_cast<std::size_t>(r)], r, 0};
+        }));
+    }
 
-        const float cx = (w - 1) * 0.5f;
-        const float cy = (h - 1) * 0.5f;
-        const int max_r = static_cast<int>(std::sqrt(cx * cx + cy * cy)) + 1;
+    // Frame orientation of the column/row engines: frames are columns for
+    // left/right directions and rows for top/bottom ones.
+    struct FrameAxis { bool columns, reversed; };
+    FrameAxis frame_axis(const char *engine) const
+    {
+        switch (m_direction)
+        {
+            case Direction::LEFT_TO_RIGHT: return {true, false};
+            case Direction::RIGHT_TO_LEFT: return {true, true};
+            case Direction::TOP_TO_BOTTOM: return {false, false};
+            case Direction::BOTTOM_TO_TOP: return {false, true};
+            default:
+                throw std::runtime_error(std::string("sonify: the ") + engine
+                                         + " engine needs a left/right or "
+                                           "top/bottom direction");
+        }
+    }
+
+    // Spectrogram engine: frame m is column m (left/right directions) or row
+    // m (top/bottom), read as a magnitude spectrum. Pixel j along the frame,
+    // from the bottom (or left) edge, is placed at the FreqMap frequency for
+    // j / (len - 1), split linearly between the two nearest FFT bins. Frames
+    // are one hop (spu) apart and rendered by inverse STFT with overlap-add,
+    // split across thread_count() threads. Without Griffin-Lim every bin
+    // keeps a phase-coherent sinusoid across frames (random start phase per
+    // bin, so a flat column is not a click); with it, phases are refined by
+    // alternating projections. An oscillator per pixel would cost
+    // O(h * samples); this is O(frames * N log N).
+    void sonify_spectrogram()
+    {
+        const auto [x0, y0, x1, y1] = effective_bounds();
 
-        std::vector<float> ring_r(max_r + 1, 0.f);
-        std::vector<float> ring_g(max_r + 1, 0.f);
-        std::vector<float> ring_b(max_r + 1, 0.f);
-        std::vector<int>   ring_count(max_r + 1, 0);
+        const auto [columns, reversed] = frame_axis("spectrogram");
 
-        const auto [bx0, by0, bx1, by1] = effective_bounds();
-        for (int y = by0; y < by1; ++y)
-            for (int x = bx0; x < bx1; ++x)
+        const int frames  = columns ? x1 - x0 : y1 - y0;
+        const int len     = columns ? y1 - y0 : x1 - x0; // pixels per frame
+        const int hop     = samples_per_unit();
+        const int iters   = std::max(0, m_spectrogram.griffin_lim);
+
+        int n = m_spectrogram.fft_size > 0
+                    ? FFT::next_pow2(m_spectrogram.fft_size)
+                    : FFT::next_pow2(std::max(1024, 4 * hop));
+        n = std::max(n, FFT::next_pow2(2 * hop)); // Hann OLA needs overlap
+
+        m_audio_data.clear();
+        m_strips_total.store(frames * (1 + 2 * iters), std::memory_order_relaxed);
+        if (frames <= 0 || len <= 0)
+            return;
+
+        const STFT stft(n, hop, frames);
+        const int bins = stft.bins();
+
+        // Pixel j -> (bin, fraction towards bin + 1)
+        struct Tap { int bin; float frac; };
+        std::vector<Tap> taps(len);
+        for (int j = 0; j < len; ++j)
+        {
+            const float u = len > 1 ? static_cast<float>(j) / (len - 1) : 0.0f;
+            const float f = map_frequency(u, m_freq_map.scale, m_freq_map.min,
+                                          m_freq_map.max);
+            const float pos = std::clamp(f / m_sample_rate * n, 0.0f,
+                                         static_cast<float>(n / 2));
+            const int bin   = static_cast<int>(pos);
+            taps[j]         = Tap{bin, pos - static_cast<float>(bin)};
+        }
+
+        // An inverse-FFT bin of magnitude n / 2 is a unit-amplitude sinusoid
+        const float amp = 0.5f * static_cast<float>(n);
+        auto magnitudes = [&](int m, float *mag)
+        {
+            std::fill(mag, mag + bins, 0.0f);
+            const int f = reversed ? frames - 1 - m : m;
+            for (int j = 0; j < len; ++j)
             {
-                const float dx = x - cx;
-                const float dy = y - cy;
-                const int r = static_cast<int>(std::sqrt(dx * dx + dy * dy));
-                const float *px = &m_img.data[y * m_img.stride + x * m_img.channels];
-                ring_r[r] += px[0];
-                ring_g[r] += (m_img.channels >= 3) ? px[1] : px[0];
-                ring_b[r] += (m_img.channels >= 3) ? px[2] : px[0];
-                ++ring_count[r];
+                const int x = columns ? x0 + f : x0 + j;
+                const int y = columns ? y1 - 1 - j : y0 + f;
+                const float b = pixel_brightness(
+                    &m_img.data[y * m_img.stride + x * m_img.channels],
+                    m_img.channels) * amp;
+                const Tap t = taps[j];
+                mag[t.bin] += b * (1.0f - t.frac);
+                if (t.bin + 1 < bins)
+                    mag[t.bin + 1] += b * t.frac;
             }
+        };
+
+        // Phase of bin k at the start of frame m for a sinusoid running
+        // continuously at the bin's centre frequency.
+        std::vector<float> phase0(bins);
+        std::uint32_t seed = 0x9e3779b9u;
+        for (auto &p : phase0)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            p    = static_cast<float>(seed >> 8) * (6.2831853f / 16777216.0f);
+        }
+        auto coherent = [&](int m, const float *mag, FFT::cfloat *X)
+        {
+            const long long s = stft.start(m);
+            for (int k = 0; k < bins; ++k)
+            {
+                const float a = phase0[k]
+                                + 6.2831853f * static_cast<float>((k * s) % n) / n;
+                X[k] = std::polar(mag[k], a);
+            }
+        };
+
+        const int n_chunks = std::clamp(m_thread_count, 1, frames);
+
+        // Inverse STFT: each chunk overlap-adds its frames into a private
+        // buffer, then the buffers are summed into the extended signal.
+        std::vector<float> x(stft.extended_length());
+        auto overlap_add = [&](auto &&spectrum_of)
+        {
+            std::vector<float> norm(x.size(), 0.0f);
+            std::fill(x.begin(), x.end(), 0.0f);
+            std::vector<std::vector<float>> part_out(n_chunks), part_norm(n_chunks);
+            std::vector<std::ptrdiff_t> part_base(n_chunks, 0);
+            run_chunks(n_chunks, frames, [&](int c, int begin, int end)
+            {
+                if (begin >= end)
+                    return;
+                const std::ptrdiff_t base = stft.start(begin);
+                const std::size_t size    = static_cast<std::size_t>(
+                    stft.start(end - 1) + n - base);
+                part_base[c] = base;
+                part_out[c].assign(size, 0.0f);
+                part_norm[c].assign(size, 0.0f);
+                std::vector<FFT::cfloat> X(bins), scratch;
+                for (int m = begin; m < end && !cancelled(); ++m)
+                {
+                    spectrum_of(m, X.data());
+                    stft.synthesize(X.data(), m, part_out[c], part_norm[c],
+                                    base, scratch);
+                    m_strips_done.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            for (int c = 0; c < n_chunks; ++c)
+                for (std::size_t i = 0; i < part_out[c].size(); ++i)
+                {
+                    x[part_base[c] + i]    += part_out[c][i];
+                    norm[part_base[c] + i] += part_norm[c][i];
+                }
+            for (std::size_t i = 0; i < x.size(); ++i)
+                x[i] = norm[i] > 1e-3f ? x[i] / norm[i] : 0.0f;
+        };
+
+        if (iters == 0)
+        {
+            overlap_add([&](int m, FFT::cfloat *X)
+            {
+                thread_local std::vector<float> mag;
+                mag.resize(bins);
+                magnitudes(m, mag.data());
+                coherent(m, mag.data(), X);
+            });
+        }
+        else
+        {
+            // Griffin-Lim: keep the target magnitudes, replace the phases with
+            // those of the STFT of the current estimate, repeat.
+            const std::size_t fb = static_cast<std::size_t>(frames) * bins;
+            std::vector<float> mags(fb);
+            std::vector<FFT::cfloat> spec(fb);
+            run_chunks(n_chunks, frames, [&](int, int begin, int end)
+            {
+                for (int m = begin; m < end; ++m)
+                {
+                    float *mag = &mags[static_cast<std::size_t>(m) * bins];
+                    magnitudes(m, mag);
+                    coherent(m, mag, &spec[static_cast<std::size_t>(m) * bins]);
+                }
+            });
+            auto stored = [&](int m, FFT::cfloat *X)
+            {
+                std::copy_n(&spec[static_cast<std::size_t>(m) * bins], bins, X);
+            };
+
+            for (int it = 0; it < iters && !cancelled(); ++it)
+            {
+                overlap_add(stored);
+                run_chunks(n_chunks, frames, [&](int, int begin, int end)
+                {
+                    std::vector<FFT::cfloat> Y(bins), scratch;
+                    for (int m = begin; m < end && !cancelled(); ++m)
+                    {
+                        stft.analyze(x, m, Y.data(), scratch);
+                        const std::size_t o = static_cast<std::size_t>(m) * bins;
+                        for (int k = 0; k < bins; ++k)
+                        {
+                            // Not std::abs/std::norm: both go through hypot
+                            const float re = Y[k].real(), im = Y[k].imag();
+                            const float r  = std::sqrt(re * re + im * im);
+                            if (r > 1e-9f)
+                                spec[o + k] = Y[k] * (mags[o + k] / r);
+                        }
+                        m_strips_done.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+            overlap_add(stored);
+        }
+
+        if (cancelled())
+            return;
+
+        // Crop the padding; scale down only if the sum of bins clips
+        const auto first = x.begin() + stft.padding();
+        const auto last  = first + static_cast<std::ptrdiff_t>(frames) * hop;
+        float peak = 0.0f;
+        for (auto it = first; it != last; ++it)
+            peak = std::max(peak, std::abs(*it));
+        const float gain = peak > 1.0f ? 1.0f / peak : 1.0f;
+
+        m_audio_data.reserve(static_cast<std::size_t>(frames) * hop * m_channel_count);
+        for (auto it = first; it != last; ++it)
+            for (int ch = 0; ch < m_channel_count; ++ch)
+                m_audio_data.push_back(*it * gain);
+    }
+
+    // (Re)builds one wavetable per column (or row) inside the bounds, in
+    // image order: a column is read top to bottom, a row left to right.
+    // Kept until the image, bounds or orientation change.
+    void build_wavetables(const Bounds &bounds, bool columns)
+    {
+        const auto [x0, y0, x1, y1] = bounds;
+        const WavetableKey key{m_image_version, x0, y0, x1, y1, columns};
+        if (!m_wavetables.empty() && key == m_wavetable_key)
+            return;
+
+        const int count = columns ? x1 - x0 : y1 - y0;
+        const int len   = columns ? y1 - y0 : x1 - x0;
+        m_wavetables.reset(0);
+        if (count <= 0 || len <= 0)
+            return;
+        m_wavetables.reset(count);
+
+        const FFT fft(WavetableBank::SIZE);
+        const int n_chunks = std::clamp(m_thread_count, 1, count);
+        run_chunks(n_chunks, count, [&](int, int begin, int end)
+        {
+            std::vector<float> cycle(len);
+            std::vector<FFT::cfloat> scratch;
+            for (int f = begin; f < end && !cancelled(); ++f)
+            {
+                for (int j = 0; j < len; ++j)
+                {
+                    const int x = columns ? x0 + f : x0 + j;
+                    const int y = columns ? y0 + j : y0 + f;
+                    cycle[j] = pixel_brightness(
+                        &m_img.data[y * m_img.stride + x * m_img.channels],
+                        m_img.channels);
+                }
+                m_wavetables.set(f, cycle.data(), len, fft, scratch);
+            }
+        });
+        if (cancelled())
+            m_wavetables.reset(0); // partially built
+        else
+            m_wavetable_key = key;
+    }
+
+    // Wavetable engine: the pixels of each column (or row) are one cycle of
+    // a waveform, played at the FreqMap pitch of the strip's brightness and
+    // crossfaded into the next strip's table over the strip. The mip level
+    // is picked per strip so the table never aliases. Runs as a thread-safe
+    // built-in sonify function over the usual strips.
+    void sonify_wavetable()
+    {
+        const auto [columns, reversed] = frame_axis("wavetable");
+        build_wavetables(effective_bounds(), columns);
+        if (cancelled())
+        {
+            m_audio_data.clear();
+            return;
+        }
+
+        const int count = m_wavetables.count();
+        const SonifyFunc func
+            = [this, count, reversed](const SonifyContext &ctx, std::vector<float> &out)
+        {
+            const float b    = std::clamp(ctx.brightness, 0.0f, 1.0f);
+            const float freq = map_frequency(b, ctx.freq_scale, ctx.fmin, ctx.fmax);
+            const std::uint64_t inc = phase_increment(freq, ctx.sample_rate);
+            const int level = WavetableBank::level_for(freq, ctx.sample_rate);
+
+            const int i    = std::clamp(ctx.strip_index, 0, count - 1);
+            const int next = std::min(i + 1, count - 1);
+            const float *from = m_wavetables.table(reversed ? count - 1 - i : i, level);
+            const float *to   = m_wavetables.table(reversed ? count - 1 - next : next, level);
+
+            const float step = 1.0f / static_cast<float>(ctx.n_samples);
+            std::uint64_t phase = ctx.phase;
+            for (int k = 0; k < ctx.n_samples; ++k)
+            {
+                phase += inc;
+                const float a = WavetableBank::lookup(from, phase);
+                const float z = WavetableBank::lookup(to, phase);
+                const float s = b * (a + (z - a) * (static_cast<float>(k) * step));
+                for (int ch = 0; ch < ctx.channel_count; ++ch)
+                    out.push_back(s);
+            }
+        };
+
+        switch (m_direction)
+        {
+            case Direction::LEFT_TO_RIGHT: sonify_left_to_right(&func); break;
+            case Direction::RIGHT_TO_LEFT: sonify_right_to_left(&func); break;
+            case Direction::TOP_TO_BOTTOM: sonify_top_to_bottom(&func); break;
+            default:                       sonify_bottom_to_top(&func); break;
+        }
+    }
+
+    // Granular engine: the bounds are cut into tile x tile pixel tiles and
+    // swept like the strips, one tile column (or row) per `tile` strips.
+    // While it is swept, every tile emits Hann-windowed sine grains:
+    //   rate     = density * tile value (grains per second)
+    //   pitch    = FreqMap of the tile brightness
+    //   length   = grain_min .. grain_max by tile saturation
+    //   pan      = tile position across the sweep (top/left = left)
+    //   amp      = tile brightness
+    // Onsets are evenly spaced with `jitter` randomization from a generator
+    // seeded per tile, so the output does not depend on the thread count.
+    // All grains are scheduled into the pool first; the output is then mixed
+    // in disjoint frame ranges on thread_count() threads.
+    void sonify_granular()
+    {
+        const auto [columns, reversed] = frame_axis("granular");
+        const auto [x0, y0, x1, y1]    = effective_bounds();
+        const GranularOpts &o          = m_granular;
+
+        const int frames = columns ? x1 - x0 : y1 - y0; // strips
+        const int len    = columns ? y1 - y0 : x1 - x0;
+        const int spu    = samples_per_unit();
+        const int tile   = std::max(1, o.tile);
+        const int across = (len + tile - 1) / tile;
+        const int along  = (frames + tile - 1) / tile;
 
         m_audio_data.clear();
-        m_audio_data.reserve(static_cast<std::size_t>(max_r + 1) * spu * m_channel_count);
+        m_strips_total.store(frames, std::memory_order_relaxed);
+        if (frames <= 0 || len <= 0)
+            return;
 
-        const int strip_count = max_r + 1;
-        for (int i = 0; i <= max_r; ++i)
+        const int n_chunks = std::clamp(m_thread_count, 1, along);
+
+        // Tile averages, indexed [sweep position * across + position across]
+        std::vector<StripData> tiles(static_cast<std::size_t>(along) * across);
+        with_layout<Alpha::IGNORE>([&](auto layout)
         {
-            const int r = outwards ? i : (max_r - i);
-            const float n = ring_count[r] > 0 ? static_cast<float>(ring_count[r]) : 1.f;
-            emit_strip(make_strip_data(ring_r[r] / n, ring_g[r] / n, ring_b[r] / n),
-                       r, 0, w, h, spu, i, strip_count);
+            using L = decltype(layout);
+            run_chunks(n_chunks, along, [&](int, int begin, int end)
+            {
+                for (int a = begin; a < end && !cancelled(); ++a)
+                {
+                    // Image-order strips of window(a); reversed sweeps
+                    // count them from the far edge
+                    const int f0 = reversed ? std::max(0, frames - (a + 1) * tile) : a * tile;
+                    const int f1 = reversed ? frames - a * tile : std::min(frames, (a + 1) * tile);
+                    for (int c = 0; c < across; ++c)
+                    {
+                        const int j0 = c * tile, j1 = std::min(len, j0 + tile);
+                        const int tx0 = columns ? x0 + f0 : x0 + j0;
+                        const int tx1 = columns ? x0 + f1 : x0 + j1;
+                        const int ty0 = columns ? y0 + j0 : y0 + f0;
+                        const int ty1 = columns ? y0 + j1 : y0 + f1;
+                        Sum s;
+                        for (int y = ty0; y < ty1; ++y)
+                        {
+                            const Sum row = sum_run<L>(&m_img.data[y * m_img.stride + tx0 * L::CHANNELS],
+                                                       tx1 - tx0, L::CHANNELS);
+                            s.r += row.r;
+                            s.g += row.g;
+                            s.b += row.b;
+                            s.n += row.n;
+                        }
+                        tiles[static_cast<std::size_t>(a) * across + c] = s.mean();
+                    }
+                }
+            });
+        });
+        if (cancelled())
+            return;
+
+        // Sweep position a covers strips [a * tile, min(frames, (a + 1) * tile))
+        auto window = [&](int a)
+        {
+            const std::int64_t s0 = static_cast<std::int64_t>(a) * tile * spu;
+            const std::int64_t s1 = static_cast<std::int64_t>(std::min(frames, (a + 1) * tile)) * spu;
+            return std::pair{s0, s1};
+        };
+        auto rng_next = [](std::uint32_t &state)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+        };
+        auto tile_seed = [across](int a, int c)
+        {
+            return (static_cast<std::uint32_t>(a * across + c) + 1u) * 0x9e3779b9u;
+        };
+
+        // Grain count per tile first, so the pool is sized exactly and each
+        // tile fills its own slots
+        const std::size_t n_tiles = tiles.size();
+        std::vector<std::size_t> offset(n_tiles + 1, 0);
+        for (int a = 0; a < along; ++a)
+        {
+            const auto [s0, s1] = window(a);
+            const float secs    = static_cast<float>(s1 - s0) / m_sample_rate;
+            for (int c = 0; c < across; ++c)
+            {
+                const std::size_t t = static_cast<std::size_t>(a) * across + c;
+                std::uint32_t state = tile_seed(a, c);
+                const float expected = std::max(0.0f, o.density * tiles[t].v * secs);
+                offset[t + 1] = static_cast<std::size_t>(expected + rng_next(state));
+            }
         }
+        for (std::size_t t = 0; t < n_tiles; ++t)
+            offset[t + 1] += offset[t];
+        m_grains.reset(offset[n_tiles]);
+
+        const float grain_min = std::max(0.0f, std::min(o.grain_min, o.grain_max));
+        const float grain_max = std::max(grain_min, o.grain_max);
+        run_chunks(n_chunks, along, [&](int, int begin, int end)
+        {
+            for (int a = begin; a < end; ++a)
+            {
+                const auto [s0, s1] = window(a);
+                for (int c = 0; c < across; ++c)
+                {
+                    const std::size_t t = static_cast<std::size_t>(a) * across + c;
+                    const std::size_t n = offset[t + 1] - offset[t];
+                    if (n == 0)
+                        continue;
+                    const StripData &d  = tiles[t];
+                    std::uint32_t state = tile_seed(a, c);
+                    rng_next(state); // consumed by the count
+
+                    const float b    = std::clamp(d.brightness, 0.0f, 1.0f);
+                    const float freq = map_frequency(b, m_freq_map.scale,
+                                                     m_freq_map.min, m_freq_map.max);
+                    const float inc  = std::clamp(freq / m_sample_rate, 0.0f, 0.5f);
+                    const int length = std::max(1, static_cast<int>(
+                        (grain_min + (grain_max - grain_min) * d.s) * m_sample_rate));
+                    const float p    = (static_cast<float>(c) + 0.5f) / across;
+                    const float pan_l = std::cos(p * 1.5707963f);
+                    const float pan_r = std::sin(p * 1.5707963f);
+                    const double spacing = static_cast<double>(s1 - s0) / n;
+
+                    for (std::size_t g = 0; g < n; ++g)
+                    {
+                        const double jitter = o.jitter * (rng_next(state) - 0.5f);
+                        m_grains[offset[t] + g] = Grain{
+                            .start  = s0 + static_cast<std::int64_t>(spacing * (g + 0.5 + jitter)),
+                            .length = length,
+                            .phase  = rng_next(state),
+                            .inc    = inc,
+                            .amp    = b,
+                            .pan_l  = pan_l,
+                            .pan_r  = pan_r,
+                        };
+                    }
+                }
+            }
+        });
+        m_grains.finalize();
+
+        // Mix in blocks of strips so cancellation and progress stay responsive
+        const int ch = m_channel_count;
+        m_audio_data.assign(static_cast<std::size_t>(frames) * spu * ch, 0.0f);
+        run_chunks(std::clamp(m_thread_count, 1, frames), frames,
+                   [&](int, int begin, int end)
+        {
+            std::vector<float> scratch;
+            for (int b = begin; b < end && !cancelled(); b += CANCEL_BLOCK)
+            {
+                const int e = std::min(end, b + CANCEL_BLOCK);
+                const std::int64_t f0 = static_cast<std::int64_t>(b) * spu;
+                m_grains.mix(f0, static_cast<std::int64_t>(e) * spu,
+                             &m_audio_data[static_cast<std::size_t>(f0) * ch], ch,
+                             scratch);
+                m_strips_done.fetch_add(e - b, std::memory_order_relaxed);
+            }
+        });
+
+        if (cancelled())
+        {
+            m_audio_data.clear();
+            return;
+        }
+
+        // Scale down only if overlapping grains clip
+        float peak = 0.0f;
+        for (float v : m_audio_data)
+            peak = std::max(peak, std::abs(v));
+        if (peak > 1.0f)
+            for (float &v : m_audio_data)
+                v /= peak;
     }
 };
 
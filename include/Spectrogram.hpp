@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+namespace sonify
+{
+
+/* In-place iterative radix-2 complex FFT of a fixed power-of-two size.
+ * Twiddles and the bit-reversal permutation are computed once, so a single
+ * instance can be shared by any number of threads. */
+class FFT
+{
+public:
+    using cfloat = std::complex<float>;
+
+    explicit FFT(int n)
+        : m_n(n), m_rev(n), m_twiddle(n / 2), m_twiddle_inv(n / 2)
+    {
+        int bits = 0;
+        while ((1 << bits) < n)
+            ++bits;
+        for (int i = 0; i < n; ++i)
+        {
+            int r = 0;
+            for (int b = 0; b < bits; ++b)
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            m_rev[i] = r;
+        }
+        for (int k = 0; k < n / 2; ++k)
+        {
+            const double a   = -2.0 * 3.141592653589793 * k / n;
+            m_twiddle[k]     = cfloat(static_cast<float>(std::cos(a)),
+                                      static_cast<float>(std::sin(a)));
+            m_twiddle_inv[k] = std::conj(m_twiddle[k]);
+        }
+    }
+
+    inline int size() const noexcept { return m_n; }
+
+    // Forward transform, or the unscaled inverse when `inverse` is set
+    // (divide by size() to invert exactly).
+    void transform(cfloat *data, bool inverse) const noexcept
+    {
+        for (int i = 0; i < m_n; ++i)
+            if (i < m_rev[i])
+                std::swap(data[i], data[m_rev[i]]);
+
+        // Butterflies on split re/im floats: std::complex operator* goes
+        // through the NaN-checking __mulsc3 without -ffast-math, and GCC
+        // vectorizes the plain loop far better.
+        float *d        = reinterpret_cast<float *>(data);
+        const float *tw = reinterpret_cast<const float *>(
+            inverse ? m_twiddle_inv.data() : m_twiddle.data());
+        for (int len = 2; len <= m_n; len <<= 1)
+        {
+            const int half   = len / 2;
+            const int stride = m_n / len;
+            for (int i = 0; i < m_n; i += len)
+            {
+                float *a = d + 2 * i;
+                float *b = d + 2 * (i + half);
+                for (int k = 0; k < half; ++k)
+                {
+                    const float wr = tw[2 * k * stride];
+                    const float wi = tw[2 * k * stride + 1];
+                    const float br = b[2 * k], bi = b[2 * k + 1];
+                    const float vr = br * wr - bi * wi;
+                    const float vi = br * wi + bi * wr;
+                    const float ar = a[2 * k], ai = a[2 * k + 1];
+                    a[2 * k]     = ar + vr;
+                    a[2 * k + 1] = ai + vi;
+                    b[2 * k]     = ar - vr;
+                    b[2 * k + 1] = ai - vi;
+                }
+            }
+        }
+    }
+
+    static int next_pow2(int n) noexcept
+    {
+        int p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+private:
+    int m_n;
+    std::vector<int> m_rev;
+    std::vector<cfloat> m_twiddle;
+    std::vector<cfloat> m_twiddle_inv;
+};
+
+/* Short-time Fourier synthesis on a fixed frame grid.
+ *
+ * Frame m covers samples [start(m), start(m) + N) of an extended signal that
+ * has N / 2 samples of padding on both sides, so that frame m is centred on
+ * the middle of hop slot m. Synthesis is weighted overlap-add with a
+ * periodic Hann window (x = sum w * ifft(X_m) / sum w^2), which is the exact
+ * inverse of analyze(); that pair is what Griffin-Lim iterates on.
+ *
+ * Spectra hold the N / 2 + 1 non-negative frequency bins of a real signal.
+ * All methods work on frame ranges so callers can split frames across
+ * threads; each thread needs its own scratch buffer. */
+class STFT
+{
+public:
+    using cfloat = std::complex<float>;
+
+    STFT(int fft_size, int hop, int frames)
+        : m_fft(fft_size), m_hop(hop), m_frames(frames), m_window(fft_size)
+    {
+        constexpr double two_pi = 6.283185307179586;
+        for (int n = 0; n < fft_size; ++n)
+            m_window[n] = static_cast<float>(
+                0.5 - 0.5 * std::cos(two_pi * n / fft_size));
+    }
+
+    inline int size() const noexcept   { return m_fft.size(); }
+    inline int bins() const noexcept   { return m_fft.size() / 2 + 1; }
+    inline int hop() const noexcept    { return m_hop; }
+    inline int frames() const noexcept { return m_frames; }
+    inline int padding() const noexcept { return m_fft.size() / 2; }
+
+    // Length of the extended signal (frames * hop plus padding).
+    inline std::size_t extended_length() const noexcept
+    {
+        return static_cast<std::size_t>(m_frames) * m_hop + m_fft.size();
+    }
+
+    // First extended-signal sample of frame m.
+    inline std::ptrdiff_t start(int m) const noexcept
+    {
+        return static_cast<std::ptrdiff_t>(m) * m_hop + m_hop / 2;
+    }
+
+    // Overlap-adds frame m (spectrum `X`, bins() values) into `out` and its
+    // squared window into `norm`, both indexed from extended sample `base`.
+    void synthesize(const cfloat *X, int m, std::vector<float> &out,
+                    std::vector<float> &norm, std::ptrdiff_t base,
+                    std::vector<cfloat> &scratch) const
+    {
+        const int n = m_fft.size();
+        scratch.resize(n);
+        scratch[0] = X[0];
+        for (int k = 1; k < n / 2; ++k)
+        {
+            scratch[k]     = X[k];
+            scratch[n - k] = std::conj(X[k]);
+        }
+        scratch[n / 2] = X[n / 2];
+        m_fft.transform(scratch.data(), true);
+
+        const float scale        = 1.0f / static_cast<float>(n);
+        const std::ptrdiff_t off = start(m) - base;
+        for (int i = 0; i < n; ++i)
+        {
+            const float w = m_window[i];
+            out[off + i]  += w * scratch[i].real() * scale;
+            norm[off + i] += w * w;
+        }
+    }
+
+    // Spectrum of frame m of the extended signal `x` into `X`.
+    void analyze(const std::vector<float> &x, int m, cfloat *X,
+                 std::vector<cfloat> &scratch) const
+    {
+        const int n = m_fft.size();
+        scratch.resize(n);
+        const std::ptrdiff_t s = start(m);
+        for (int i = 0; i < n; ++i)
+            scratch[i] = cfloat(x[s + i] * m_window[i], 0.0f);
+        m_fft.transform(scratch.data(), false);
+        for (int k = 0; k < bins(); ++k)
+            X[k] = scratch[k];
+    }
+
+private:
+    FFT m_fft;
+    int m_hop;
+    int m_frames;
+    std::vector<float> m_window;
+};
+
+} // namespace sonify
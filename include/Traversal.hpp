@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sonify
+{
+
+/* Compact pixel-order traversal.
+ *
+ * Pixels are stored as uint32 linear indices (y * width + x) grouped into
+ * runs. An arithmetic run covers `first, first + step, first + 2 * step, ...`
+ * in constant space, so scanline, zigzag and diagonal orders collapse to one
+ * run per line. Irregular stretches (random or data-driven orders) are
+ * spilled into a shared literal array at 4 bytes per pixel. */
+class Traversal
+{
+public:
+    Traversal() = default;
+    Traversal(int width, int height) noexcept
+        : m_width(width), m_height(height)
+    {}
+
+    void reset(int width, int height) noexcept
+    {
+        m_width  = width;
+        m_height = height;
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        m_runs.clear();
+        m_literals.clear();
+        m_size = 0;
+    }
+
+    inline int width() const noexcept          { return m_width; }
+    inline int height() const noexcept         { return m_height; }
+    inline std::size_t size() const noexcept   { return m_size; }
+    inline bool empty() const noexcept         { return m_size == 0; }
+    inline std::size_t run_count() const noexcept { return m_runs.size(); }
+
+    // Bytes held by the encoded form (excluding the object itself).
+    std::size_t memory_bytes() const noexcept
+    {
+        return m_runs.capacity() * sizeof(Run)
+               + m_literals.capacity() * sizeof(std::uint32_t);
+    }
+
+    void shrink_to_fit()
+    {
+        m_runs.shrink_to_fit();
+        m_literals.shrink_to_fit();
+    }
+
+    // Append pixel (x, y). Coordinates must lie inside width x height.
+    void push(int x, int y)
+    {
+        const std::uint32_t idx = static_cast<std::uint32_t>(y)
+                                      * static_cast<std::uint32_t>(m_width)
+                                  + static_cast<std::uint32_t>(x);
+        const auto pos = static_cast<std::uint32_t>(m_size++);
+
+        if (m_runs.empty() || m_runs.back().literal)
+        {
+            m_runs.push_back(Run{pos, idx, 0, 1, false});
+            return;
+        }
+
+        Run &r = m_runs.back();
+        if (r.count == 1)
+        {
+            const std::int64_t d = static_cast<std::int64_t>(idx)
+                                   - static_cast<std::int64_t>(r.first);
+            if (d >= INT32_MIN && d <= INT32_MAX)
+            {
+                r.step  = static_cast<std::int32_t>(d);
+                r.count = 2;
+                return;
+            }
+        }
+        else if (static_cast<std::int64_t>(r.first)
+                     + static_cast<std::int64_t>(r.step) * r.count
+                 == static_cast<std::int64_t>(idx))
+        {
+            ++r.count;
+            return;
+        }
+
+        // Run broken: keep it if it's long enough to pay for itself,
+        // otherwise spill it into the literal array.
+        if (r.count < MIN_RUN)
+            spill_last_run();
+        m_runs.push_back(Run{pos, idx, 0, 1, false});
+    }
+
+    // Pixel at sequence position i (O(log runs)).
+    std::pair<int, int> at(std::size_t i) const noexcept
+    {
+        const auto it = std::upper_bound(
+            m_runs.begin(), m_runs.end(), static_cast<std::uint32_t>(i),
+            [](std::uint32_t v, const Run &r) { return v < r.pos; });
+        return decode(index_in(*(it - 1), static_cast<std::uint32_t>(i)));
+    }
+
+    // Calls fn(x, y, i) for every pixel in [begin, end) in traversal order.
+    template <typename Fn>
+    void for_each(std::size_t begin, std::size_t end, Fn &&fn) const
+    {
+        end = std::min(end, m_size);
+        if (begin >= end)
+            return;
+
+        auto it = std::upper_bound(
+            m_runs.begin(), m_runs.end(), static_cast<std::uint32_t>(begin),
+            [](std::uint32_t v, const Run &r) { return v < r.pos; }) - 1;
+
+        std::size_t i = begin;
+        for (; i < end; ++it)
+        {
+            const Run &r          = *it;
+            const std::size_t off = i - r.pos;
+            const std::size_t n   = std::min<std::size_t>(r.count - off, end - i);
+            for (std::size_t k = off; k < off + n; ++k, ++i)
+            {
+                const auto [x, y] = decode(
+                    index_in(r, static_cast<std::uint32_t>(r.pos + k)));
+                fn(x, y, i);
+            }
+        }
+    }
+
+    template <typename Fn>
+    void for_each(Fn &&fn) const
+    {
+        for_each(0, m_size, std::forward<Fn>(fn));
+    }
+
+private:
+    // Arithmetic runs shorter than this are stored as literals (a 20-byte run
+    // header only beats 4-byte literals once it covers several pixels).
+    static constexpr std::uint32_t MIN_RUN = 6;
+
+    struct Run
+    {
+        std::uint32_t pos;   // sequence position of the first pixel
+        std::uint32_t first; // first linear index, or offset into m_literals
+        std::int32_t  step;  // linear index delta (arithmetic runs only)
+        std::uint32_t count;
+        bool literal;
+    };
+
+    int m_width  = 0;
+    int m_height = 0;
+    std::size_t m_size = 0;
+    std::vector<Run> m_runs;
+    std::vector<std::uint32_t> m_literals;
+
+    std::uint32_t index_in(const Run &r, std::uint32_t i) const noexcept
+    {
+        const std::uint32_t k = i - r.pos;
+        if (r.literal)
+            return m_literals[r.first + k];
+        return static_cast<std::uint32_t>(
+            static_cast<std::int64_t>(r.first)
+            + static_cast<std::int64_t>(r.step) * k);
+    }
+
+    std::pair<int, int> decode(std::uint32_t idx) const noexcept
+    {
+        const auto w = static_cast<std::uint32_t>(m_width);
+        return {static_cast<int>(idx % w), static_cast<int>(idx / w)};
+    }
+
+    // Convert the trailing arithmetic run into literals, merging with the
+    // preceding literal run when there is one. The preceding literal run (if
+    // any) always owns the tail of m_literals, so the merge is an append.
+    void spill_last_run()
+    {
+        const Run r = m_runs.back();
+        m_runs.pop_back();
+
+        const auto offset = static_cast<std::uint32_t>(m_literals.size());
+        for (std::uint32_t k = 0; k < r.count; ++k)
+            m_literals.push_back(index_in(r, r.pos + k));
+
+        if (!m_runs.empty() && m_runs.back().literal)
+            m_runs.back().count += r.count;
+        else
+            m_runs.push_back(Run{r.pos, offset, 0, r.count, true});
+    }
+};
+
+} // namespace sonify
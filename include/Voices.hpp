@@ -0,0 +1,370 @@
+#pragma once
+
+#include "FastMath.hpp"
+#include "SonifyEngine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sonify
+{
+
+enum class VoiceType
+{
+    FM = 0, // sine carrier phase-modulated by a sine
+    SAW,    // PolyBLEP sawtooth
+    SQUARE, // PolyBLEP square
+    NOISE,  // white noise through a one-pole low-pass
+};
+
+/* Parameters of a native voice. The carrier pitch is the frequency map of
+ * the strip brightness, as for the built-in sine.
+ *
+ * With `decay` > 0 the voice is driven by an envelope follower instead of
+ * the strip brightness: a rolling average of brightness is kept across
+ * strips, and a strip brighter than 1.5 x the average by more than
+ * `threshold` re-triggers the envelope and latches the pitch, FM ratio and
+ * FM index; the envelope then decays with time constant `decay` and scales
+ * both the output and the FM index. */
+struct VoiceParams
+{
+    VoiceType type = VoiceType::FM;
+    float gain     = 1.0f;
+
+    float ratio            = 2.0f; // FM modulator / carrier frequency
+    float ratio_hue        = 0.0f; // added to ratio times sin(hue / 2)
+    float index            = 1.0f; // FM modulation index in radians
+    float index_saturation = 0.0f; // added to index times saturation
+
+    float cutoff = 0.0f; // noise low-pass cutoff in Hz (0 = carrier pitch)
+
+    float decay     = 0.0f;  // envelope time constant in seconds (0 = off)
+    float threshold = 0.02f; // envelope trigger threshold
+    float smoothing = 0.97f; // per-strip weight of the old rolling average
+    float drone     = 0.0f;  // level of a sine at the rolling average pitch
+
+    bool pan_x = false; // stereo pan by strip x (left edge = left)
+};
+
+namespace voices
+{
+
+namespace detail
+{
+
+constexpr int LANES = 8; // see GrainPool::mix()
+
+// PolyBLEP residual at phase t (turns) for increment 1 / inv_dt. The two
+// polynomial segments are masked with integer arithmetic: GCC will not
+// if-convert float compares (or std::min on floats) under the default
+// -ftrapping-math, and a branch keeps the caller's loop from vectorizing.
+inline float
+poly_blep(float t, float inv_dt) noexcept
+{
+    const float x  = t * inv_dt;          // < 1 just after the wrap
+    const float y  = (1.0f - t) * inv_dt; // < 1 just before it
+    const float in_x = static_cast<float>(1 - std::min(static_cast<int>(x), 1));
+    const float in_y = static_cast<float>(1 - std::min(static_cast<int>(y), 1));
+    return (1.0f - y) * (1.0f - y) * in_y - (1.0f - x) * (1.0f - x) * in_x;
+}
+
+// Pitch and FM settings of the carrier. Taken per strip, or
+// latched when the envelope triggers.
+struct Tone
+{
+    float freq  = 0.0f;
+    float ratio = 1.0f;
+    float index = 0.0f;
+};
+
+inline Tone
+tone_of(const VoiceParams &p, const SonifyContext &ctx, float b) noexcept
+{
+    Tone t;
+    t.freq  = map_frequency(b, ctx.freq_scale, ctx.fmin, ctx.fmax);
+    t.ratio = p.ratio + p.ratio_hue * std::sin(ctx.h * 0.5f * 0.017453292f);
+    t.index = p.index + p.index_saturation * ctx.s;
+    return t;
+}
+
+// State a voice carries between strips of one render
+struct State
+{
+    std::uint64_t carrier = 0, modulator = 0, drone = 0;
+    float env = 0.0f, avg = 0.05f;
+    Tone latched;
+    std::uint32_t noise = 0x12345678u;
+    float lp = 0.0f;
+    std::uint64_t render_id = 0; // render this state belongs to
+};
+
+// n rounded up to whole blocks of LANES; buffers passed to fill() have at
+// least this many elements
+inline int
+padded(int n) noexcept
+{
+    return (n + LANES - 1) / LANES * LANES;
+}
+
+// s[k] = fn(k) for k in [0, padded(n)), in fixed blocks of LANES so that
+// GCC vectorizes it at -O2 (its default cost model skips loops with a
+// runtime trip count). The padding samples are garbage.
+template <typename Fn>
+inline void
+fill(float *__restrict s, int n, Fn &&fn)
+{
+    for (int k = 0; k < n; k += LANES)
+        for (int j = 0; j < LANES; ++j)
+            s[k + j] = fn(k + j);
+}
+
+// 32-bit phase to turns in [0, 1). Through int32: unsigned-to-float has no
+// SSE2 instruction and would not vectorize.
+inline float
+turns(std::uint32_t phase) noexcept
+{
+    return static_cast<float>(static_cast<std::int32_t>(phase >> 8))
+           * (1.0f / 16777216.0f);
+}
+
+// Renders n samples of the periodic voices into `s` (mono, before gain),
+// scaled by the per-sample envelope `env`; with `env_index` it scales the
+// FM index too. Phases are the 64-bit ones at the start of the strip; the
+// loops run on their top 32 bits, which wrap for free, and sample k uses
+// the phase after k + 1 increments, as sine() does.
+inline void
+render_periodic(const VoiceParams &p, const Tone &tone, float sample_rate,
+                std::uint64_t carrier, std::uint64_t modulator, int n,
+                const float *__restrict env, bool env_index, float *__restrict s)
+{
+    const std::uint32_t c0 = static_cast<std::uint32_t>(carrier >> 32);
+    const std::uint32_t ci = static_cast<std::uint32_t>(
+        phase_increment(tone.freq, sample_rate) >> 32);
+    auto carrier_at = [=](int k)
+    { return turns(c0 + ci * static_cast<std::uint32_t>(k + 1)); };
+
+    switch (p.type)
+    {
+        case VoiceType::SAW:
+        {
+            const float inv_dt = sample_rate / std::max(tone.freq, 2.0f * sample_rate / 65536.0f);
+            fill(s, n, [&](int k)
+            {
+                const float t = carrier_at(k);
+                return env[k] * (2.0f * t - 1.0f - poly_blep(t, inv_dt));
+            });
+            break;
+        }
+        case VoiceType::SQUARE:
+        {
+            const float inv_dt = sample_rate / std::max(tone.freq, 2.0f * sample_rate / 65536.0f);
+            fill(s, n, [&](int k)
+            {
+                const std::uint32_t pk = c0 + ci * static_cast<std::uint32_t>(k + 1);
+                const float t  = turns(pk);
+                const float t2 = turns(pk + 0x80000000u); // half a cycle on
+                const float sq = 1.0f - 2.0f * static_cast<float>(
+                                                   static_cast<std::int32_t>(pk >> 31));
+                return env[k] * (sq + poly_blep(t, inv_dt) - poly_blep(t2, inv_dt));
+            });
+            break;
+        }
+        default:
+        {
+            const std::uint32_t m0 = static_cast<std::uint32_t>(modulator >> 32);
+            const std::uint32_t mi = static_cast<std::uint32_t>(
+                phase_increment(tone.freq * tone.ratio, sample_rate) >> 32);
+            const float index = tone.index * 0.15915494f; // radians -> turns
+            // depth = index * (env_index ? env : 1), without a select
+            const float w = env_index ? 1.0f : 0.0f;
+            fill(s, n, [&](int k)
+            {
+                const float mod = fast_sin_turns(
+                    turns(m0 + mi * static_cast<std::uint32_t>(k + 1)));
+                const float depth = index * (w * env[k] + (1.0f - w));
+                return env[k] * fast_sin_turns(carrier_at(k) + depth * mod);
+            });
+            break;
+        }
+    }
+}
+
+// White noise through a one-pole low-pass; inherently serial.
+inline void
+render_noise(const Tone &tone, float cutoff, float sample_rate, State &st,
+             int n, const float *env, float *s)
+{
+    const float fc    = cutoff > 0.0f ? cutoff : tone.freq;
+    const float alpha = 1.0f - std::exp(-6.2831853f * fc / sample_rate);
+    for (int k = 0; k < n; ++k)
+    {
+        st.noise ^= st.noise << 13;
+        st.noise ^= st.noise >> 17;
+        st.noise ^= st.noise << 5;
+        const float w = turns(st.noise) * 2.0f - 1.0f;
+        st.lp += alpha * (w - st.lp);
+        s[k] = env[k] * st.lp;
+    }
+}
+
+// Per-sample envelope env0 * mul^k. A running product, computed once so
+// that the synthesis loops stay vectorizable; flushed to zero once
+// inaudible, since denormals would slow every loop that reads it.
+inline const float *
+envelope(float env0, float mul, int n)
+{
+    thread_local std::vector<float> env;
+    env.resize(static_cast<std::size_t>(padded(n)));
+    float e = env0;
+    for (int k = 0; k < padded(n); ++k)
+    {
+        env[k] = e;
+        e *= mul;
+        if (e < 1e-6f)
+            e = 0.0f;
+    }
+    return env.data();
+}
+
+inline void
+write_out(const SonifyContext &ctx, const VoiceParams &p, const float *s,
+          std::vector<float> &out)
+{
+    const std::size_t base = out.size();
+    out.resize(base + static_cast<std::size_t>(ctx.n_samples) * ctx.channel_count);
+    float *o = out.data() + base;
+    if (ctx.channel_count == 1)
+    {
+        for (int k = 0; k < ctx.n_samples; ++k)
+            o[k] = p.gain * s[k];
+        return;
+    }
+    float l = p.gain, r = p.gain;
+    if (p.pan_x && ctx.width > 0)
+    {
+        r = p.gain * static_cast<float>(ctx.x) / static_cast<float>(ctx.width);
+        l = p.gain - r;
+    }
+    for (int k = 0; k < ctx.n_samples; ++k)
+        for (int ch = 0; ch < ctx.channel_count; ++ch)
+            o[k * ctx.channel_count + ch] = s[k] * ((ch & 1) ? r : l);
+}
+
+} // namespace detail
+
+/* Whether the voice keeps no state between strips, so it can be rendered
+ * in parallel: no envelope or drone, and a waveform that depends only on
+ * the carrier phase (ctx.phase). An FM modulator is phase-exact from
+ * ctx.phase only at a whole-number, hue-independent ratio. */
+inline bool
+thread_safe(const VoiceParams &p) noexcept
+{
+    if (p.decay > 0.0f || p.drone > 0.0f || p.type == VoiceType::NOISE)
+        return false;
+    if (p.type == VoiceType::FM)
+        return p.ratio_hue == 0.0f && p.ratio >= 1.0f
+               && p.ratio == std::floor(p.ratio) && p.ratio < 65536.0f;
+    return true;
+}
+
+/* SonifyFunc playing `p`. State, where there is any, lives in the function
+ * and is reset at the start of every render (a new ctx.render_id), so it
+ * carries on across the frames of a sequence or stream. */
+inline SonifyFunc
+make(const VoiceParams &p)
+{
+    if (thread_safe(p))
+    {
+        return [p](const SonifyContext &ctx, std::vector<float> &out)
+        {
+            const float b = std::clamp(ctx.brightness, 0.0f, 1.0f);
+            const detail::Tone tone = detail::tone_of(p, ctx, b);
+            const std::uint64_t mod
+                = ctx.phase * static_cast<std::uint64_t>(tone.ratio);
+            thread_local std::vector<float> s;
+            s.resize(static_cast<std::size_t>(detail::padded(ctx.n_samples)));
+            detail::render_periodic(p, tone, ctx.sample_rate, ctx.phase, mod,
+                                    ctx.n_samples,
+                                    detail::envelope(b, 1.0f, ctx.n_samples),
+                                    false, s.data());
+            detail::write_out(ctx, p, s.data(), out);
+        };
+    }
+
+    auto state = std::make_shared<detail::State>();
+    return [p, state](const SonifyContext &ctx, std::vector<float> &out)
+    {
+        detail::State &st = *state;
+        if (ctx.render_id != st.render_id)
+        {
+            st           = detail::State{};
+            st.render_id = ctx.render_id;
+        }
+
+        const float b = std::clamp(ctx.brightness, 0.0f, 1.0f);
+        const int n   = ctx.n_samples;
+        st.avg = st.avg * p.smoothing + b * (1.0f - p.smoothing);
+
+        detail::Tone tone;
+        float env0 = b, env_mul = 1.0f;
+        if (p.decay > 0.0f)
+        {
+            const float excess = b - st.avg * 1.5f;
+            if (excess > p.threshold)
+            {
+                st.env     = std::min(1.0f, st.env + excess * 4.0f);
+                st.latched = detail::tone_of(p, ctx, b);
+            }
+            tone    = st.latched;
+            env0    = st.env;
+            env_mul = std::exp(-1.0f / (ctx.sample_rate * p.decay));
+            st.env *= std::pow(env_mul, static_cast<float>(n));
+            if (st.env < 1e-6f)
+                st.env = 0.0f;
+        }
+        else
+            tone = detail::tone_of(p, ctx, b);
+
+        thread_local std::vector<float> s;
+        s.resize(static_cast<std::size_t>(detail::padded(n)));
+        const float *env = detail::envelope(env0, env_mul, n);
+        if (p.type == VoiceType::NOISE)
+            detail::render_noise(tone, p.cutoff, ctx.sample_rate, st, n, env,
+                                 s.data());
+        else
+        {
+            detail::render_periodic(p, tone, ctx.sample_rate, st.carrier,
+                                    st.modulator, n, env, p.decay > 0.0f,
+                                    s.data());
+            st.carrier   += phase_increment(tone.freq, ctx.sample_rate)
+                            * static_cast<std::uint64_t>(n);
+            st.modulator += phase_increment(tone.freq * tone.ratio, ctx.sample_rate)
+                            * static_cast<std::uint64_t>(n);
+        }
+
+        if (p.drone > 0.0f)
+        {
+            const float f = map_frequency(st.avg * 0.3f, ctx.freq_scale,
+                                          ctx.fmin, ctx.fmax);
+            const std::uint64_t inc = phase_increment(f, ctx.sample_rate);
+            const std::uint32_t d0  = static_cast<std::uint32_t>(st.drone >> 32);
+            const std::uint32_t di  = static_cast<std::uint32_t>(inc >> 32);
+            float *__restrict out_s = s.data();
+            detail::fill(out_s, n, [&](int k)
+            {
+                return out_s[k] + p.drone * fast_sin_turns(detail::turns(
+                    d0 + di * static_cast<std::uint32_t>(k + 1)));
+            });
+            st.drone += inc * static_cast<std::uint64_t>(n);
+        }
+
+        detail::write_out(ctx, p, s.data(), out);
+    };
+}
+
+} // namespace voices
+
+} // namespace sonify
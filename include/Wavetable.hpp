@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Spectrogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace sonify
+{
+
+/* Single-cycle wavetables, one per strip, each with band-limited mip levels.
+ *
+ * Level l of a table keeps harmonics 1 .. (SIZE / 2) >> l, so playing a table
+ * at frequency f through level_for(f) never produces partials above Nyquist.
+ * Levels are built once with an FFT per table; playback is a table lookup
+ * with linear interpolation. */
+class WavetableBank
+{
+public:
+    static constexpr int SIZE   = 256;
+    static constexpr int LEVELS = 8; // 128, 64, ..., 1 harmonics
+
+    // Resizes the bank to `count` tables (contents undefined until set()).
+    void reset(int count)
+    {
+        m_count = count;
+        m_data.assign(static_cast<std::size_t>(count) * LEVELS * SIZE, 0.0f);
+    }
+
+    inline int  count() const noexcept { return m_count; }
+    inline bool empty() const noexcept { return m_count == 0; }
+
+    // Builds every level of table `i` from `len` samples of one cycle.
+    // The cycle is resampled to SIZE, its DC removed and its peak
+    // normalized to 1 (a flat cycle stays silent). Safe to call
+    // concurrently for different `i`; `fft` (of size SIZE) may be shared,
+    // `scratch` may not.
+    void set(int i, const float *cycle, int len, const FFT &fft,
+             std::vector<FFT::cfloat> &scratch)
+    {
+        float base[SIZE];
+        for (int s = 0; s < SIZE; ++s)
+        {
+            const float pos = len > 1 ? static_cast<float>(s) * (len - 1) / SIZE : 0.0f;
+            const int   k   = static_cast<int>(pos);
+            const float f   = pos - static_cast<float>(k);
+            base[s] = k + 1 < len ? cycle[k] * (1.0f - f) + cycle[k + 1] * f
+                                  : cycle[std::min(k, len - 1)];
+        }
+
+        float mean = 0.0f;
+        for (float v : base)
+            mean += v;
+        mean /= SIZE;
+        float peak = 0.0f;
+        for (float &v : base)
+        {
+            v -= mean;
+            peak = std::max(peak, std::abs(v));
+        }
+        const float norm = peak > 1e-6f ? 1.0f / peak : 0.0f;
+
+        scratch.resize(SIZE);
+        FFT::cfloat spectrum[SIZE];
+        for (int s = 0; s < SIZE; ++s)
+            spectrum[s] = FFT::cfloat(base[s] * norm, 0.0f);
+        fft.transform(spectrum, false);
+
+        for (int l = 0; l < LEVELS; ++l)
+        {
+            const int harmonics = (SIZE / 2) >> l;
+            std::fill(scratch.begin(), scratch.end(), FFT::cfloat{});
+            for (int h = 1; h <= harmonics && h < SIZE / 2; ++h)
+            {
+                scratch[h]        = spectrum[h];
+                scratch[SIZE - h] = spectrum[SIZE - h];
+            }
+            if (harmonics == SIZE / 2)
+                scratch[SIZE / 2] = spectrum[SIZE / 2];
+            fft.transform(scratch.data(), true);
+
+            float *out = table_data(i, l);
+            for (int s = 0; s < SIZE; ++s)
+                out[s] = scratch[s].real() / SIZE;
+        }
+    }
+
+    // Highest level whose harmonics all stay below Nyquist at `freq`.
+    static int level_for(float freq, float sample_rate) noexcept
+    {
+        const float max_harmonic = sample_rate * 0.5f / std::max(freq, 1e-3f);
+        int l = 0;
+        while (l < LEVELS - 1 && static_cast<float>((SIZE / 2) >> l) > max_harmonic)
+            ++l;
+        return l;
+    }
+
+    inline const float *table(int i, int level) const noexcept
+    {
+        return &m_data[(static_cast<std::size_t>(i) * LEVELS + level) * SIZE];
+    }
+
+    // Linear-interpolated lookup at a fixed-point phase (2^64 = one cycle).
+    static inline float lookup(const float *t, std::uint64_t phase) noexcept
+    {
+        const int   i = static_cast<int>(phase >> 56);
+        const float f = static_cast<float>((phase >> 32) & 0xFFFFFF) * (1.0f / 16777216.0f);
+        return t[i] + (t[(i + 1) & (SIZE - 1)] - t[i]) * f;
+    }
+
+private:
+    float *table_data(int i, int level) noexcept
+    {
+        return &m_data[(static_cast<std::size_t>(i) * LEVELS + level) * SIZE];
+    }
+
+    int m_count = 0;
+    std::vector<float> m_data;
+};
+
+} // namespace sonify
@@ -2,6 +2,12 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
 template <typename T>
@@ -26,3 +32,48 @@ convert_to_int16(const std::vector<T> &in)
 
     return out;
 }
+
+/* Read-only memory mapping of a whole file; the pages are shared with the
+ * page cache, so reading a file through it never copies it into the heap. */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open file: " + path);
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Failed to read file: " + path);
+        }
+
+        m_size = static_cast<std::size_t>(st.st_size);
+        void *p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps its own reference
+        if (p == MAP_FAILED)
+            throw std::runtime_error("Failed to map file: " + path);
+
+        m_data = static_cast<const std::uint8_t *>(p);
+        ::madvise(p, m_size, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile()
+    {
+        if (m_data)
+            ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+    }
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const std::uint8_t *data() const noexcept { return m_data; }
+    std::size_t         size() const noexcept { return m_size; }
+
+private:
+    const std::uint8_t *m_data = nullptr;
+    std::size_t         m_size = 0;
+};
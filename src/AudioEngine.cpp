@@ -4,6 +4,23 @@
 #include "logging.hpp"
 #include "utils.hpp"
 
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+static std::vector<sf::SoundChannel>
+channel_map(int channel_count)
+{
+    if (channel_count == 2)
+        return {sf::SoundChannel::FrontLeft, sf::SoundChannel::FrontRight};
+    return {sf::SoundChannel::Mono};
+}
+
 AudioEngine::AudioEngine()
     : m_sound(m_sound_buffer), m_scrub_sound(m_scrub_buffer)
 {
@@ -36,15 +53,9 @@ AudioEngine::set_data(std::vector<float> &&audio_data, float sample_rate)
     m_dataf       = std::move(audio_data);
     m_data  = convert_to_int16(m_dataf);
 
-    std::vector<sf::SoundChannel> channelMap;
-    if (m_channel_count == 2)
-        channelMap = {sf::SoundChannel::FrontLeft, sf::SoundChannel::FrontRight};
-    else
-        channelMap = {sf::SoundChannel::Mono};
-
     if (!m_sound_buffer.loadFromSamples(m_data.data(), m_data.size(),
                                         m_channel_count, m_sample_rate,
-                                        channelMap))
+                                        channel_map(m_channel_count)))
     {
         LOG("Unable to load samples from audio data", LogLevel::ERROR);
     }
@@ -77,14 +88,9 @@ AudioEngine::play_sample_at(std::size_t sample) noexcept
     const std::size_t start = std::min(sample, total - 1);
     const std::size_t end   = std::min(start + WINDOW, total);
 
-    std::vector<sf::SoundChannel> channelMap;
-    if (m_channel_count == 2)
-        channelMap = {sf::SoundChannel::FrontLeft, sf::SoundChannel::FrontRight};
-    else
-        channelMap = {sf::SoundChannel::Mono};
     if (!m_scrub_buffer.loadFromSamples(m_data.data() + start, end - start,
                                         m_channel_count, m_sample_rate,
-                                        channelMap))
+                                        channel_map(m_channel_count)))
         return;
 
     m_scrub_sound = sf::Sound(m_scrub_buffer);
@@ -111,3 +117,251 @@ AudioEngine::sample_index() const noexcept
 
     return static_cast<std::size_t>(s * m_sample_rate * m_channel_count);
 }
+
+LiveStream::LiveStream(float sample_rate, int channel_count, std::size_t depth)
+    : m_queue(depth),
+      // 10 ms, whole frames
+      m_silence(static_cast<std::size_t>(sample_rate / 100.0f) * channel_count, 0)
+{
+    initialize(static_cast<unsigned>(channel_count),
+               static_cast<unsigned>(sample_rate), channel_map(channel_count));
+}
+
+LiveStream::~LiveStream()
+{
+    // The stream thread calls onGetData(), which must not outlive the queue
+    m_queue.close();
+    stop();
+}
+
+bool
+LiveStream::push(const std::vector<float> &samples)
+{
+    return m_queue.push(convert_to_int16(samples));
+}
+
+void
+LiveStream::finish() noexcept
+{
+    m_queue.close();
+}
+
+void
+LiveStream::wait() const noexcept
+{
+    while (getStatus() == sf::SoundSource::Status::Playing)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+bool
+LiveStream::onGetData(Chunk &data)
+{
+    // Checked before popping: a queue seen closed and then empty is drained
+    const bool closed = m_queue.closed();
+    if (m_queue.try_pop(m_playing))
+    {
+        data.samples     = m_playing.data();
+        data.sampleCount = m_playing.size();
+        return true;
+    }
+    if (closed)
+        return false;
+    data.samples     = m_silence.data();
+    data.sampleCount = m_silence.size();
+    return true;
+}
+
+PcmWriter::Format
+PcmWriter::parse_format(const std::string &name)
+{
+    if (name == "s16")
+        return Format::S16;
+    if (name == "f32")
+        return Format::F32;
+    throw std::runtime_error("Invalid PCM format: " + name
+                             + " (expected s16 or f32)");
+}
+
+void
+PcmWriter::write(const std::vector<float> &samples)
+{
+    const char *data  = reinterpret_cast<const char *>(samples.data());
+    std::size_t bytes = samples.size() * sizeof(float);
+    if (m_format == Format::S16)
+    {
+        m_s16.resize(samples.size());
+        std::transform(samples.begin(), samples.end(), m_s16.begin(), [](float s)
+        { return static_cast<std::int16_t>(std::clamp(s, -1.0f, 1.0f) * 32767); });
+        data  = reinterpret_cast<const char *>(m_s16.data());
+        bytes = m_s16.size() * sizeof(std::int16_t);
+    }
+
+    while (bytes > 0)
+    {
+        const ssize_t n = ::write(m_fd, data, bytes);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error(std::string("Failed to write PCM: ")
+                                     + std::strerror(errno));
+        data += n;
+        bytes -= static_cast<std::size_t>(n);
+    }
+}
+
+BackgroundEncoder::BackgroundEncoder(const std::string &path,
+                                     unsigned int sample_rate,
+                                     int channel_count, std::size_t depth)
+    : m_path(path), m_queue(depth)
+{
+    if (!m_file.openFromFile(path, sample_rate,
+                             static_cast<unsigned int>(channel_count),
+                             channel_map(channel_count)))
+        throw std::runtime_error("Failed to open " + path + " for writing");
+
+    m_thread = std::thread([this]
+    {
+        std::vector<std::int16_t> block;
+        try
+        {
+            while (m_queue.pop(block))
+                m_file.write(block.data(), block.size());
+        }
+        catch (...)
+        {
+            m_failed.store(true, std::memory_order_relaxed);
+            m_queue.close(); // push() sees the failure at once
+        }
+    });
+}
+
+BackgroundEncoder::~BackgroundEncoder()
+{
+    finish();
+}
+
+void
+BackgroundEncoder::push(const std::vector<float> &samples)
+{
+    if (samples.empty())
+        return;
+    if (!m_queue.push(convert_to_int16(samples)))
+        throw std::runtime_error("Failed to encode " + m_path);
+    m_pushed += samples.size();
+}
+
+bool
+BackgroundEncoder::finish() noexcept
+{
+    if (m_thread.joinable())
+    {
+        m_queue.close();
+        m_thread.join();
+        m_file.close();
+        if (!m_failed.load(std::memory_order_relaxed))
+        {
+            sf::InputSoundFile check;
+            if (!check.openFromFile(m_path) || check.getSampleCount() != m_pushed)
+                m_failed.store(true, std::memory_order_relaxed);
+        }
+    }
+    return !m_failed.load(std::memory_order_relaxed);
+}
+
+WavMapping::WavMapping(const std::string &path, std::size_t samples,
+                       int channel_count, unsigned int sample_rate)
+    : m_count(samples)
+{
+    const std::uint64_t data_bytes = static_cast<std::uint64_t>(samples) * sizeof(float);
+    const std::uint32_t block      = static_cast<std::uint32_t>(channel_count) * sizeof(float);
+    const std::uint64_t frames     = samples / static_cast<std::size_t>(channel_count);
+
+    std::vector<std::uint8_t> header;
+    auto tag = [&](const char *id) { header.insert(header.end(), id, id + 4); };
+    auto put = [&](std::uint64_t v, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            header.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+    };
+    auto clamp32 = [](std::uint64_t v) { return std::min<std::uint64_t>(v, 0xFFFFFFFF); };
+
+    // RIFF sizes are 32-bit; beyond that, RF64 moves them to a ds64 chunk and
+    // marks the 32-bit fields 0xFFFFFFFF. The sizes depend on the header's
+    // length, so lay it out first and patch the ds64 fields after.
+    const bool rf64 = data_bytes > 0xFFFFFFFF - 128;
+    tag(rf64 ? "RF64" : "RIFF");
+    put(0, 4);
+    tag("WAVE");
+    std::size_t ds64 = 0;
+    if (rf64)
+    {
+        tag("ds64");
+        put(28, 4);
+        ds64 = header.size();
+        put(0, 8);
+        put(data_bytes, 8);
+        put(frames, 8);
+        put(0, 4);
+    }
+    tag("fmt ");
+    put(18, 4);
+    put(3, 2); // WAVE_FORMAT_IEEE_FLOAT
+    put(static_cast<std::uint64_t>(channel_count), 2);
+    put(sample_rate, 4);
+    put(static_cast<std::uint64_t>(sample_rate) * block, 4);
+    put(block, 2);
+    put(32, 2);
+    put(0, 2);
+    tag("fact");
+    put(4, 4);
+    put(clamp32(frames), 4);
+    // Pad with a JUNK chunk so the samples start 16-byte aligned
+    const std::size_t pad = (16 - (header.size() + 16) % 16) % 16;
+    tag("JUNK");
+    put(pad, 4);
+    header.insert(header.end(), pad, 0);
+    tag("data");
+    put(rf64 ? 0xFFFFFFFF : data_bytes, 4);
+
+    m_size = header.size() + data_bytes;
+    const std::uint64_t riff_size = m_size - 8;
+    if (rf64)
+    {
+        for (int i = 0; i < 8; ++i)
+            header[ds64 + i] = static_cast<std::uint8_t>(riff_size >> (8 * i));
+    }
+    for (int i = 0; i < 4; ++i)
+        header[4 + i] = static_cast<std::uint8_t>(clamp32(riff_size) >> (8 * i));
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create " + path + ": " + std::strerror(errno));
+    // Allocate every block now: a sparse file would run out of disk in the
+    // middle of the render, where a store through the mapping raises SIGBUS
+    // instead of failing. The new blocks read as zeros, which the engine
+    // relies on for silent strips.
+    if (const int err = ::posix_fallocate(fd, 0, static_cast<off_t>(m_size)); err != 0)
+    {
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw std::runtime_error("Failed to allocate " + path + ": " + std::strerror(err));
+    }
+    m_map = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (m_map == MAP_FAILED)
+    {
+        m_map = nullptr;
+        throw std::runtime_error("Failed to map " + path + ": " + std::strerror(err));
+    }
+
+    auto *bytes = static_cast<std::uint8_t *>(m_map);
+    std::copy(header.begin(), header.end(), bytes);
+    m_samples = reinterpret_cast<float *>(bytes + header.size());
+}
+
+WavMapping::~WavMapping()
+{
+    if (m_map)
+        ::munmap(m_map, m_size);
+}
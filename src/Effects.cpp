@@ -1,8 +1,11 @@
 #include "Effects.hpp"
 
+#include "Config.hpp"
+
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <optional>
 
 void
 Effects::Gain(std::vector<float> &data, float gain) noexcept
@@ -11,31 +14,6 @@ Effects::Gain(std::vector<float> &data, float gain) noexcept
         s *= gain;
 }
 
-std::vector<float>
-Effects::Delay(const std::vector<float> &data, float sample_rate,
-               float delay_time, float feedback, float mix)
-{
-    if (data.empty())
-        return {};
-
-    const std::size_t delay_samples
-        = std::max(std::size_t{1},
-                   static_cast<std::size_t>(delay_time * sample_rate));
-
-    std::vector<float> delay_buf(delay_samples, 0.f);
-    std::vector<float> out(data.size());
-
-    for (std::size_t i = 0; i < data.size(); ++i)
-    {
-        const std::size_t pos = i % delay_samples;
-        const float delayed   = delay_buf[pos];
-        delay_buf[pos]        = data[i] + feedback * delayed;
-        out[i]                = (1.f - mix) * data[i] + mix * delayed;
-    }
-
-    return out;
-}
-
 // ---------------------------------------------------------------------------
 // Schroeder reverb
 // Four parallel feedback comb filters → two series allpass filters.
@@ -87,71 +65,173 @@ struct AllpassFilter
     }
 };
 
-} // namespace
-
-std::vector<float>
-Effects::Reverb(const std::vector<float> &data, float sample_rate,
-                float room_size, float damping, float mix)
+struct SchroederReverb
 {
-    if (data.empty())
-        return {};
+    std::vector<CombFilter> combs;
+    std::vector<AllpassFilter> allpasses;
+    float mix;
 
-    // Scale canonical 44100 Hz delay lengths to the actual sample rate
-    const float sr_scale = sample_rate / 44100.f;
+    SchroederReverb(float sample_rate, float room_size, float damping, float m)
+        : mix(m)
+    {
+        // Scale canonical 44100 Hz delay lengths to the actual sample rate
+        const float sr_scale = sample_rate / 44100.f;
+
+        // Feedback proportional to room_size; clamped to keep it stable
+        const float fb = std::clamp(0.70f + room_size * 0.28f, 0.f, 0.98f);
+        const float d  = std::clamp(damping, 0.f, 1.f);
+
+        // Classic Schroeder comb delay lengths (samples at 44100 Hz)
+        for (const std::size_t delay : {1557u, 1617u, 1491u, 1422u})
+            combs.emplace_back(static_cast<std::size_t>(delay * sr_scale), fb, d);
+        for (const std::size_t delay : {225u, 556u})
+            allpasses.emplace_back(static_cast<std::size_t>(delay * sr_scale), 0.5f);
+    }
 
-    // Feedback proportional to room_size; clamped to keep it stable
-    const float fb = std::clamp(0.70f + room_size * 0.28f, 0.f, 0.98f);
-    const float d  = std::clamp(damping, 0.f, 1.f);
+    float process(float x) noexcept
+    {
+        float wet = 0.f;
+        for (auto &c : combs)
+            wet += c.process(x);
+        wet *= 0.25f; // average
 
-    // Classic Schroeder comb delay lengths (samples at 44100 Hz)
-    const std::size_t comb_delays[4] = {1557, 1617, 1491, 1422};
-    CombFilter combs[4] = {
-        {static_cast<std::size_t>(comb_delays[0] * sr_scale), fb, d},
-        {static_cast<std::size_t>(comb_delays[1] * sr_scale), fb, d},
-        {static_cast<std::size_t>(comb_delays[2] * sr_scale), fb, d},
-        {static_cast<std::size_t>(comb_delays[3] * sr_scale), fb, d},
-    };
+        for (auto &a : allpasses)
+            wet = a.process(wet);
 
-    const std::size_t ap_delays[2] = {225, 556};
-    AllpassFilter allpasses[2] = {
-        {static_cast<std::size_t>(ap_delays[0] * sr_scale), 0.5f},
-        {static_cast<std::size_t>(ap_delays[1] * sr_scale), 0.5f},
-    };
+        return (1.f - mix) * x + mix * wet;
+    }
+};
 
-    std::vector<float> out(data.size());
+struct DelayLine
+{
+    std::vector<float> buf;
+    std::size_t pos = 0;
+    float feedback;
+    float mix;
+
+    DelayLine(float sample_rate, float delay_time, float fb, float m)
+        : buf(std::max(std::size_t{1},
+                       static_cast<std::size_t>(delay_time * sample_rate)),
+              0.f),
+          feedback(fb), mix(m)
+    {}
 
-    for (std::size_t i = 0; i < data.size(); ++i)
+    float process(float x) noexcept
     {
-        float wet = 0.f;
-        for (auto &c : combs)
-            wet += c.process(data[i]);
-        wet *= 0.25f; // average
+        const float delayed = buf[pos];
+        buf[pos]            = x + feedback * delayed;
+        pos                 = (pos + 1) % buf.size();
+        return (1.f - mix) * x + mix * delayed;
+    }
+};
 
-        wet = allpasses[0].process(wet);
-        wet = allpasses[1].process(wet);
+struct SoftClip
+{
+    float g;    // drive [0,1] mapped to a gain factor [1,20]
+    float norm; // tanh(g) normalises the output to [-1,1]
+    float mix;
+
+    SoftClip(float drive, float m)
+        : g(1.f + drive * 19.f), norm(std::tanh(1.f + drive * 19.f)), mix(m)
+    {}
 
-        out[i] = (1.f - mix) * data[i] + mix * wet;
+    float process(float x) const noexcept
+    {
+        const float wet = std::tanh(x * g) / norm;
+        return (1.f - mix) * x + mix * wet;
     }
+};
 
+template <typename Unit>
+std::vector<float>
+apply(Unit &unit, const std::vector<float> &data)
+{
+    std::vector<float> out(data.size());
+    for (std::size_t i = 0; i < data.size(); ++i)
+        out[i] = unit.process(data[i]);
     return out;
 }
 
+} // namespace
+
+std::vector<float>
+Effects::Delay(const std::vector<float> &data, float sample_rate,
+               float delay_time, float feedback, float mix)
+{
+    if (data.empty())
+        return {};
+    DelayLine delay(sample_rate, delay_time, feedback, mix);
+    return apply(delay, data);
+}
+
+std::vector<float>
+Effects::Reverb(const std::vector<float> &data, float sample_rate,
+                float room_size, float damping, float mix)
+{
+    if (data.empty())
+        return {};
+    SchroederReverb reverb(sample_rate, room_size, damping, mix);
+    return apply(reverb, data);
+}
+
 std::vector<float>
 Effects::Distortion(const std::vector<float> &data, float drive, float mix)
 {
     if (data.empty())
         return {};
+    const SoftClip clip(drive, mix);
+    return apply(clip, data);
+}
 
-    // Map drive [0,1] to a gain factor [1,20]
-    const float g    = 1.f + drive * 19.f;
-    const float norm = std::tanh(g); // tanh(g) normalises the output to [-1,1]
+struct EffectChain::State
+{
+    float gain;
+    std::optional<SoftClip> distortion;
+    std::optional<SchroederReverb> reverb;
+    std::optional<DelayLine> delay;
+};
 
-    std::vector<float> out(data.size());
-    for (std::size_t i = 0; i < data.size(); ++i)
+EffectChain::EffectChain(const AudioEffectsOpts &opts, float amplitude,
+                         float sample_rate)
+    : m_state(std::make_unique<State>(State{amplitude * opts.gain, {}, {}, {}}))
+{
+    if (opts.distortion_mix > 0.f)
+        m_state->distortion.emplace(opts.distortion_drive, opts.distortion_mix);
+    if (opts.reverb_mix > 0.f)
+        m_state->reverb.emplace(sample_rate, opts.reverb_room,
+                                opts.reverb_damping, opts.reverb_mix);
+    if (opts.delay_mix > 0.f)
+        m_state->delay.emplace(sample_rate, opts.delay_time,
+                               opts.delay_feedback, opts.delay_mix);
+}
+
+EffectChain::~EffectChain() = default;
+
+void
+EffectChain::process(std::vector<float> &block) noexcept
+{
+    process(std::span<float>(block));
+}
+
+void
+EffectChain::process(std::span<float> block) noexcept
+{
+    State &st = *m_state;
+    if (st.gain != 1.0f)
     {
-        const float wet = std::tanh(data[i] * g) / norm;
-        out[i]          = (1.f - mix) * data[i] + mix * wet;
+        for (float &s : block)
+            s *= st.gain;
     }
+    if (!st.distortion && !st.reverb && !st.delay)
+        return;
 
-    return out;
+    for (float &s : block)
+    {
+        if (st.distortion)
+            s = st.distortion->process(s);
+        if (st.reverb)
+            s = st.reverb->process(s);
+        if (st.delay)
+            s = st.delay->process(s);
+    }
 }
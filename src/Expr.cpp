@@ -0,0 +1,726 @@
+#include "Expr.hpp"
+#include "FastMath.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string_view>
+
+namespace sonify
+{
+
+namespace
+{
+
+constexpr float TAU     = 6.2831853f;
+constexpr float INV_TAU = 1.0f / TAU;
+
+enum class Op : std::uint8_t
+{
+    // Leaves
+    CONST, // value
+    VAR,   // strip field, value = Var
+    T,     // time in seconds
+    PHASE, // oscillator phase in radians
+    K,     // sample index in the strip
+    U,     // k / n_samples
+    NOISE, // value = call site
+
+    NEG, ADD, SUB, MUL, DIV, MOD, POW,
+    LT, LE, GT, GE, EQ, NE,
+
+    SIN, COS, TAN, ABS, FLOOR, FRACT, SQRT, EXP, LOG, TANH,
+    MIN, MAX, CLAMP, MIX, SAW, SQUARE, TRI,
+};
+
+// Strip fields, read once per strip
+enum Var
+{
+    SAMPLE_RATE, BRIGHTNESS, R, G, B, H, S, V, DELTA, DR, DG, DB,
+    X, Y, WIDTH, HEIGHT,
+    STRIP_INDEX, STRIP_COUNT, N_SAMPLES, FMIN, FMAX, FREQ,
+    VAR_COUNT
+};
+
+struct Name
+{
+    std::string_view name;
+    Op  op;
+    int arg; // Var for VAR, arity for functions
+};
+
+constexpr Name VARIABLES[] = {
+    {"sample_rate", Op::VAR, SAMPLE_RATE},
+    {"brightness", Op::VAR, BRIGHTNESS},
+    {"r", Op::VAR, R},
+    {"g", Op::VAR, G},
+    {"b", Op::VAR, B},
+    {"h", Op::VAR, H},
+    {"s", Op::VAR, S},
+    {"v", Op::VAR, V},
+    {"delta", Op::VAR, DELTA},
+    {"dr", Op::VAR, DR},
+    {"dg", Op::VAR, DG},
+    {"db", Op::VAR, DB},
+    {"x", Op::VAR, X},
+    {"y", Op::VAR, Y},
+    {"width", Op::VAR, WIDTH},
+    {"height", Op::VAR, HEIGHT},
+    {"strip_index", Op::VAR, STRIP_INDEX},
+    {"strip_count", Op::VAR, STRIP_COUNT},
+    {"n_samples", Op::VAR, N_SAMPLES},
+    {"fmin", Op::VAR, FMIN},
+    {"fmax", Op::VAR, FMAX},
+    {"freq", Op::VAR, FREQ},
+    {"t", Op::T, 0},
+    {"phase", Op::PHASE, 0},
+    {"k", Op::K, 0},
+    {"u", Op::U, 0},
+};
+
+constexpr Name FUNCTIONS[] = {
+    {"sin", Op::SIN, 1},     {"cos", Op::COS, 1},       {"tan", Op::TAN, 1},
+    {"abs", Op::ABS, 1},     {"floor", Op::FLOOR, 1},   {"fract", Op::FRACT, 1},
+    {"sqrt", Op::SQRT, 1},   {"exp", Op::EXP, 1},       {"log", Op::LOG, 1},
+    {"tanh", Op::TANH, 1},   {"pow", Op::POW, 2},       {"min", Op::MIN, 2},
+    {"max", Op::MAX, 2},     {"clamp", Op::CLAMP, 3},   {"mix", Op::MIX, 3},
+    {"saw", Op::SAW, 1},     {"square", Op::SQUARE, 1}, {"tri", Op::TRI, 1},
+    {"noise", Op::NOISE, 0},
+};
+
+/* One instruction. Its result goes to the register of the same index;
+ * operands are earlier registers (-1 = unused). */
+struct Instr
+{
+    Op    op;
+    bool  varying = false;
+    int   a = -1, b = -1, c = -1;
+    float value = 0.0f;
+};
+
+inline bool
+is_leaf(Op op) noexcept
+{
+    return op <= Op::NOISE;
+}
+
+// Inputs of the leaf instructions
+struct Frame
+{
+    const float  *vars    = nullptr;
+    float         t0      = 0.0f; // ctx.t
+    float         inv_sr  = 0.0f;
+    float         inv_n   = 0.0f;
+    float         phase0  = 0.0f; // phase of the block start, turns in [0, 1)
+    float         inc     = 0.0f; // phase increment, turns
+    int           k0      = 0;    // first sample of the block
+    std::uint32_t seed    = 0;    // noise seed of the strip
+};
+
+// White noise in [-1, 1), hashed from the seed and sample index so that
+// noise() needs no state
+inline float
+noise_at(std::uint32_t seed, std::uint32_t k) noexcept
+{
+    std::uint32_t h = seed ^ (k * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return static_cast<float>(static_cast<std::int32_t>(h)) * (1.0f / 2147483648.0f);
+}
+
+inline float
+fract(float x) noexcept
+{
+    return x - fast_floor(x);
+}
+
+// Runs one instruction over N lanes. Each case is a loop with a constant
+// trip count and no calls except for the libm functions (sqrt, exp, log,
+// pow, tanh), so the rest vectorize at -O2.
+template <int N>
+void
+run(const Instr &in, float *__restrict o, const float *__restrict a,
+    const float *__restrict b, const float *__restrict c, const Frame &f)
+{
+    switch (in.op)
+    {
+        case Op::CONST:
+            for (int j = 0; j < N; ++j)
+                o[j] = in.value;
+            break;
+        case Op::VAR:
+            for (int j = 0; j < N; ++j)
+                o[j] = f.vars[static_cast<int>(in.value)];
+            break;
+        case Op::T:
+            for (int j = 0; j < N; ++j)
+                o[j] = f.t0 + static_cast<float>(f.k0 + j) * f.inv_sr;
+            break;
+        case Op::PHASE:
+            // Sample k plays the phase after k + 1 increments, as in sine()
+            for (int j = 0; j < N; ++j)
+                o[j] = TAU * fract(f.phase0 + static_cast<float>(j + 1) * f.inc);
+            break;
+        case Op::K:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(f.k0 + j);
+            break;
+        case Op::U:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(f.k0 + j) * f.inv_n;
+            break;
+        case Op::NOISE:
+        {
+            const std::uint32_t seed
+                = f.seed ^ (static_cast<std::uint32_t>(in.value) * 0xC2B2AE35u);
+            for (int j = 0; j < N; ++j)
+                o[j] = noise_at(seed, static_cast<std::uint32_t>(f.k0 + j));
+            break;
+        }
+
+        case Op::NEG:
+            for (int j = 0; j < N; ++j)
+                o[j] = -a[j];
+            break;
+        case Op::ADD:
+            for (int j = 0; j < N; ++j)
+                o[j] = a[j] + b[j];
+            break;
+        case Op::SUB:
+            for (int j = 0; j < N; ++j)
+                o[j] = a[j] - b[j];
+            break;
+        case Op::MUL:
+            for (int j = 0; j < N; ++j)
+                o[j] = a[j] * b[j];
+            break;
+        case Op::DIV:
+            for (int j = 0; j < N; ++j)
+                o[j] = a[j] / b[j];
+            break;
+        case Op::MOD:
+            for (int j = 0; j < N; ++j)
+                o[j] = a[j] - b[j] * fast_floor(a[j] / b[j]);
+            break;
+        case Op::POW:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::pow(a[j], b[j]);
+            break;
+
+        case Op::LT:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(a[j] < b[j]);
+            break;
+        case Op::LE:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(a[j] <= b[j]);
+            break;
+        case Op::GT:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(a[j] > b[j]);
+            break;
+        case Op::GE:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(a[j] >= b[j]);
+            break;
+        case Op::EQ:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(a[j] == b[j]);
+            break;
+        case Op::NE:
+            for (int j = 0; j < N; ++j)
+                o[j] = static_cast<float>(a[j] != b[j]);
+            break;
+
+        case Op::SIN:
+            for (int j = 0; j < N; ++j)
+                o[j] = sin_turns(a[j] * INV_TAU);
+            break;
+        case Op::COS:
+            for (int j = 0; j < N; ++j)
+                o[j] = sin_turns(a[j] * INV_TAU + 0.25f);
+            break;
+        case Op::TAN:
+            for (int j = 0; j < N; ++j)
+                o[j] = sin_turns(a[j] * INV_TAU) / sin_turns(a[j] * INV_TAU + 0.25f);
+            break;
+        case Op::ABS:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::abs(a[j]);
+            break;
+        case Op::FLOOR:
+            for (int j = 0; j < N; ++j)
+                o[j] = fast_floor(a[j]);
+            break;
+        case Op::FRACT:
+            for (int j = 0; j < N; ++j)
+                o[j] = fract(a[j]);
+            break;
+        case Op::SQRT:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::sqrt(a[j]);
+            break;
+        case Op::EXP:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::exp(a[j]);
+            break;
+        case Op::LOG:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::log(a[j]);
+            break;
+        case Op::TANH:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::tanh(a[j]);
+            break;
+        case Op::MIN:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::min(a[j], b[j]);
+            break;
+        case Op::MAX:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::max(a[j], b[j]);
+            break;
+        case Op::CLAMP:
+            for (int j = 0; j < N; ++j)
+                o[j] = std::min(std::max(a[j], b[j]), c[j]);
+            break;
+        case Op::MIX:
+            for (int j = 0; j < N; ++j)
+                o[j] = a[j] + (b[j] - a[j]) * c[j];
+            break;
+        case Op::SAW:
+            for (int j = 0; j < N; ++j)
+                o[j] = 2.0f * fract(a[j] * INV_TAU) - 1.0f;
+            break;
+        case Op::SQUARE:
+            for (int j = 0; j < N; ++j)
+                o[j] = 1.0f - 2.0f * static_cast<float>(fract(a[j] * INV_TAU) >= 0.5f);
+            break;
+        case Op::TRI:
+            for (int j = 0; j < N; ++j)
+                o[j] = 4.0f * std::abs(fract(a[j] * INV_TAU - 0.25f) - 0.5f) - 1.0f;
+            break;
+    }
+}
+
+/* Recursive descent parser emitting bytecode in post-order, so operands
+ * always precede their instruction. Precedence, loosest first:
+ *
+ *     ;   < <= > >= == !=   + -   * / %   unary - +   ^ (right-associative)
+ */
+class Parser
+{
+public:
+    explicit Parser(const std::string &src) : m_src(src) {}
+
+    Expr::Program parse();
+
+private:
+    [[noreturn]] void fail(const std::string &msg, std::size_t pos) const
+    {
+        throw std::runtime_error("Expression error at column "
+                                 + std::to_string(pos + 1) + ": " + msg);
+    }
+
+    void skip_space()
+    {
+        while (m_pos < m_src.size()
+               && std::isspace(static_cast<unsigned char>(m_src[m_pos])))
+            ++m_pos;
+    }
+
+    bool accept(std::string_view token)
+    {
+        skip_space();
+        if (m_src.compare(m_pos, token.size(), token) != 0)
+            return false;
+        m_pos += token.size();
+        return true;
+    }
+
+    void expect(char c)
+    {
+        if (!accept(std::string_view(&c, 1)))
+            fail(std::string("expected '") + c + "'", m_pos);
+    }
+
+    bool at_end()
+    {
+        skip_space();
+        return m_pos == m_src.size();
+    }
+
+    int emit(Op op, int a = -1, int b = -1, int c = -1, float value = 0.0f);
+
+    int comparison();
+    int additive();
+    int multiplicative();
+    int unary();
+    int power();
+    int primary();
+
+    const std::string &m_src;
+    std::size_t m_pos = 0;
+    std::vector<Instr> m_code;
+    int m_noise_sites = 0;
+};
+
+} // namespace
+
+struct Expr::Program
+{
+    std::vector<Instr> code;
+    std::vector<int>   outputs; // register of each channel
+};
+
+namespace
+{
+
+int
+Parser::emit(Op op, int a, int b, int c, float value)
+{
+    Instr in{.op = op, .a = a, .b = b, .c = c, .value = value};
+    if (is_leaf(op))
+        in.varying = op != Op::CONST && op != Op::VAR;
+
+    bool constant = !is_leaf(op);
+    for (int r : {a, b, c})
+        if (r >= 0)
+        {
+            in.varying = in.varying || m_code[r].varying;
+            constant   = constant && m_code[r].op == Op::CONST;
+        }
+
+    // Fold through the same kernel that would run it; the operands are left
+    // for the dead code pass
+    if (constant)
+    {
+        auto arg = [&](int r) { return r >= 0 ? m_code[r].value : 0.0f; };
+        const float x[3] = {arg(a), arg(b), arg(c)};
+        float result;
+        run<1>(in, &result, &x[0], &x[1], &x[2], Frame{});
+        in = Instr{.op = Op::CONST, .value = result};
+    }
+
+    m_code.push_back(in);
+    return static_cast<int>(m_code.size()) - 1;
+}
+
+Expr::Program
+Parser::parse()
+{
+    if (at_end())
+        fail("empty expression", m_pos);
+
+    std::vector<int> outputs;
+    do
+    {
+        outputs.push_back(comparison());
+    } while (accept(";") && !at_end());
+
+    if (!at_end())
+        fail(std::string("unexpected '") + m_src[m_pos] + "'", m_pos);
+
+    // Drop instructions no output depends on and renumber the rest
+    std::vector<int> index(m_code.size(), -1);
+    for (int r : outputs)
+        index[r] = 0;
+    for (int i = static_cast<int>(m_code.size()) - 1; i >= 0; --i)
+        if (index[i] >= 0)
+            for (int r : {m_code[i].a, m_code[i].b, m_code[i].c})
+                if (r >= 0)
+                    index[r] = 0;
+
+    Expr::Program program;
+    for (std::size_t i = 0; i < m_code.size(); ++i)
+    {
+        if (index[i] < 0)
+            continue;
+        Instr in = m_code[i];
+        for (int *r : {&in.a, &in.b, &in.c})
+            if (*r >= 0)
+                *r = index[*r];
+        index[i] = static_cast<int>(program.code.size());
+        program.code.push_back(in);
+    }
+    for (int r : outputs)
+        program.outputs.push_back(index[r]);
+    return program;
+}
+
+int
+Parser::comparison()
+{
+    int lhs = additive();
+    for (;;)
+    {
+        // Two-character operators first
+        if (accept("<="))
+            lhs = emit(Op::LE, lhs, additive());
+        else if (accept(">="))
+            lhs = emit(Op::GE, lhs, additive());
+        else if (accept("=="))
+            lhs = emit(Op::EQ, lhs, additive());
+        else if (accept("!="))
+            lhs = emit(Op::NE, lhs, additive());
+        else if (accept("<"))
+            lhs = emit(Op::LT, lhs, additive());
+        else if (accept(">"))
+            lhs = emit(Op::GT, lhs, additive());
+        else
+            return lhs;
+    }
+}
+
+int
+Parser::additive()
+{
+    int lhs = multiplicative();
+    for (;;)
+    {
+        if (accept("+"))
+            lhs = emit(Op::ADD, lhs, multiplicative());
+        else if (accept("-"))
+            lhs = emit(Op::SUB, lhs, multiplicative());
+        else
+            return lhs;
+    }
+}
+
+int
+Parser::multiplicative()
+{
+    int lhs = unary();
+    for (;;)
+    {
+        if (accept("*"))
+            lhs = emit(Op::MUL, lhs, unary());
+        else if (accept("/"))
+            lhs = emit(Op::DIV, lhs, unary());
+        else if (accept("%"))
+            lhs = emit(Op::MOD, lhs, unary());
+        else
+            return lhs;
+    }
+}
+
+int
+Parser::unary()
+{
+    if (accept("-"))
+        return emit(Op::NEG, unary());
+    if (accept("+"))
+        return unary();
+    return power();
+}
+
+int
+Parser::power()
+{
+    const int base = primary();
+    if (accept("^"))
+        return emit(Op::POW, base, unary());
+    return base;
+}
+
+int
+Parser::primary()
+{
+    skip_space();
+    const std::size_t start = m_pos;
+    if (m_pos == m_src.size())
+        fail("unexpected end of expression", m_pos);
+
+    const char c = m_src[m_pos];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+    {
+        char *end;
+        const float value = std::strtof(m_src.c_str() + m_pos, &end);
+        if (end == m_src.c_str() + m_pos)
+            fail("invalid number", start);
+        m_pos = static_cast<std::size_t>(end - m_src.c_str());
+        return emit(Op::CONST, -1, -1, -1, value);
+    }
+
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+    {
+        while (m_pos < m_src.size()
+               && (std::isalnum(static_cast<unsigned char>(m_src[m_pos]))
+                   || m_src[m_pos] == '_'))
+            ++m_pos;
+        const std::string_view name(m_src.data() + start, m_pos - start);
+
+        if (accept("("))
+        {
+            const auto fn = std::find_if(std::begin(FUNCTIONS), std::end(FUNCTIONS),
+                                         [&](const Name &f) { return f.name == name; });
+            if (fn == std::end(FUNCTIONS))
+                fail("unknown function '" + std::string(name) + "'", start);
+
+            int args[3] = {-1, -1, -1};
+            int count   = 0;
+            if (!accept(")"))
+            {
+                do
+                {
+                    const int r = comparison();
+                    if (count < 3)
+                        args[count] = r;
+                    ++count;
+                } while (accept(","));
+                expect(')');
+            }
+            if (count != fn->arg)
+                fail(std::string(name) + "() takes " + std::to_string(fn->arg)
+                         + " argument" + (fn->arg == 1 ? "" : "s"),
+                     start);
+
+            if (fn->op == Op::NOISE)
+                return emit(Op::NOISE, -1, -1, -1,
+                            static_cast<float>(m_noise_sites++));
+            return emit(fn->op, args[0], args[1], args[2]);
+        }
+
+        if (name == "pi")
+            return emit(Op::CONST, -1, -1, -1, TAU * 0.5f);
+        if (name == "tau")
+            return emit(Op::CONST, -1, -1, -1, TAU);
+        const auto var = std::find_if(std::begin(VARIABLES), std::end(VARIABLES),
+                                      [&](const Name &v) { return v.name == name; });
+        if (var == std::end(VARIABLES))
+            fail("unknown variable '" + std::string(name) + "'", start);
+        return emit(var->op, -1, -1, -1, static_cast<float>(var->arg));
+    }
+
+    if (accept("("))
+    {
+        const int r = comparison();
+        expect(')');
+        return r;
+    }
+
+    fail(std::string("unexpected '") + c + "'", start);
+}
+
+// Top 24 bits of a fixed-point phase as turns in [0, 1)
+inline float
+turns(std::uint64_t phase) noexcept
+{
+    return static_cast<float>(static_cast<std::int32_t>(phase >> 40))
+           * (1.0f / 16777216.0f);
+}
+
+} // namespace
+
+Expr::Expr(const std::string &source)
+    : m_source(source),
+      m_program(std::make_shared<const Program>(Parser(source).parse()))
+{
+}
+
+int
+Expr::channels() const noexcept
+{
+    return static_cast<int>(m_program->outputs.size());
+}
+
+void
+Expr::eval(const SonifyContext &ctx, std::vector<float> &out) const
+{
+    const Program &p = *m_program;
+
+    const float b    = std::clamp(ctx.brightness, 0.0f, 1.0f);
+    const float freq = map_frequency(b, ctx.freq_scale, ctx.fmin, ctx.fmax);
+    const std::uint64_t inc = phase_increment(freq, ctx.sample_rate);
+
+    float vars[VAR_COUNT];
+    vars[SAMPLE_RATE] = ctx.sample_rate;
+    vars[BRIGHTNESS]  = ctx.brightness;
+    vars[R]           = ctx.r;
+    vars[G]           = ctx.g;
+    vars[B]           = ctx.b;
+    vars[H]           = ctx.h;
+    vars[S]           = ctx.s;
+    vars[V]           = ctx.v;
+    vars[DELTA]       = ctx.delta;
+    vars[DR]          = ctx.dr;
+    vars[DG]          = ctx.dg;
+    vars[DB]          = ctx.db;
+    vars[X]           = static_cast<float>(ctx.x);
+    vars[Y]           = static_cast<float>(ctx.y);
+    vars[WIDTH]       = static_cast<float>(ctx.width);
+    vars[HEIGHT]      = static_cast<float>(ctx.height);
+    vars[STRIP_INDEX] = static_cast<float>(ctx.strip_index);
+    vars[STRIP_COUNT] = static_cast<float>(ctx.strip_count);
+    vars[N_SAMPLES]   = static_cast<float>(ctx.n_samples);
+    vars[FMIN]        = ctx.fmin;
+    vars[FMAX]        = ctx.fmax;
+    vars[FREQ]        = freq;
+
+    Frame f;
+    f.vars   = vars;
+    f.t0     = ctx.t;
+    f.inv_sr = 1.0f / ctx.sample_rate;
+    f.inv_n  = ctx.n_samples > 0 ? 1.0f / static_cast<float>(ctx.n_samples) : 0.0f;
+    f.inc    = turns(inc);
+    f.seed   = static_cast<std::uint32_t>(ctx.strip_index) * 0x85EBCA6Bu;
+
+    thread_local std::vector<float> regs;
+    regs.resize(p.code.size() * BLOCK);
+    auto reg = [&](int r) { return regs.data() + static_cast<std::size_t>(std::max(r, 0)) * BLOCK; };
+
+    // Uniform registers: computed once, then broadcast so varying kernels
+    // can read every operand as a block
+    for (std::size_t i = 0; i < p.code.size(); ++i)
+    {
+        const Instr &in = p.code[i];
+        if (in.varying)
+            continue;
+        float *o = reg(static_cast<int>(i));
+        run<1>(in, o, reg(in.a), reg(in.b), reg(in.c), f);
+        std::fill(o + 1, o + BLOCK, o[0]);
+    }
+
+    const int n  = ctx.n_samples;
+    const int ch = ctx.channel_count;
+    const std::size_t base = out.size();
+    out.resize(base + static_cast<std::size_t>(n) * ch);
+    float *dst = out.data() + base;
+
+    for (int k0 = 0; k0 < n; k0 += BLOCK)
+    {
+        f.k0     = k0;
+        f.phase0 = turns(ctx.phase + inc * static_cast<std::uint64_t>(k0));
+        for (std::size_t i = 0; i < p.code.size(); ++i)
+        {
+            const Instr &in = p.code[i];
+            if (in.varying)
+                run<BLOCK>(in, reg(static_cast<int>(i)), reg(in.a), reg(in.b),
+                           reg(in.c), f);
+        }
+
+        const int m = std::min(BLOCK, n - k0);
+        for (int c = 0; c < ch; ++c)
+        {
+            const int r = p.outputs[std::min<std::size_t>(c, p.outputs.size() - 1)];
+            const float *src = reg(r);
+            for (int j = 0; j < m; ++j)
+                dst[(k0 + j) * ch + c] = src[j];
+        }
+    }
+}
+
+SonifyFunc
+Expr::func() const
+{
+    return [expr = *this](const SonifyContext &ctx, std::vector<float> &out)
+    { expr.eval(ctx, out); };
+}
+
+} // namespace sonify
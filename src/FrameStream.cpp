@@ -0,0 +1,96 @@
+#include "FrameStream.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+FrameStream::Format
+FrameStream::Format::parse(const std::string &spec)
+{
+    auto fail = [&]
+    {
+        return std::runtime_error("Invalid frame format `" + spec
+                                  + "' (expected WxH or WxH:gray|rgb|rgba)");
+    };
+
+    Format format;
+    const char *p   = spec.data();
+    const char *end = p + spec.size();
+    auto [xp, ex]   = std::from_chars(p, end, format.width);
+    if (ex != std::errc() || xp == end || *xp != 'x')
+        throw fail();
+    auto [hp, eh] = std::from_chars(xp + 1, end, format.height);
+    if (eh != std::errc() || format.width <= 0 || format.height <= 0)
+        throw fail();
+
+    if (hp != end)
+    {
+        if (*hp != ':')
+            throw fail();
+        const std::string layout(hp + 1, end);
+        if (layout == "gray")
+            format.channels = 1;
+        else if (layout == "rgb")
+            format.channels = 3;
+        else if (layout == "rgba")
+            format.channels = 4;
+        else
+            throw fail();
+    }
+    return format;
+}
+
+FrameStream::FrameStream(const std::string &path, const Format &format)
+    : m_format(format), m_path(path == "-" ? "stdin" : path)
+{
+    if (path == "-")
+        m_fd = STDIN_FILENO;
+    else
+    {
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+            throw std::runtime_error("Failed to open frame stream: " + path);
+        m_owns_fd = true;
+    }
+    m_bytes = std::make_unique_for_overwrite<std::uint8_t[]>(m_format.frame_bytes());
+}
+
+FrameStream::~FrameStream()
+{
+    if (m_owns_fd)
+        ::close(m_fd);
+}
+
+bool
+FrameStream::read(sonify::RawImage &img)
+{
+    const std::size_t want = m_format.frame_bytes();
+    std::size_t got        = 0;
+    while (got < want)
+    {
+        const ssize_t n = ::read(m_fd, m_bytes.get() + got, want - got);
+        if (n > 0)
+            got += static_cast<std::size_t>(n);
+        else if (n == 0)
+        {
+            if (got == 0)
+                return false;
+            throw std::runtime_error("Frame stream " + m_path + " ended "
+                                     + std::to_string(got) + " bytes into a "
+                                     + std::to_string(want) + "-byte frame");
+        }
+        else if (errno != EINTR)
+            throw std::runtime_error("Failed to read frame stream " + m_path
+                                     + ": " + std::strerror(errno));
+    }
+
+    img.width    = m_format.width;
+    img.height   = m_format.height;
+    img.channels = m_format.channels;
+    img.stride   = m_format.width * m_format.channels;
+    sonify::normalize_u8_data(m_bytes.get(), want, img.data);
+    return true;
+}
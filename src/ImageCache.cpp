@@ -0,0 +1,314 @@
+#include "ImageCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+namespace
+{
+
+// Bumped whenever the entry layout or the key changes
+constexpr std::uint32_t FORMAT_VERSION = 2;
+
+struct RgbaHeader
+{
+    char magic[8] = {'S', 'N', 'P', 'X', 'R', 'G', 'B', 'A'};
+    std::uint32_t version = FORMAT_VERSION;
+    std::uint32_t width   = 0;
+    std::uint32_t height  = 0;
+    // Size of the image file's pixels, larger when decoded at a reduced size
+    std::uint32_t source_width  = 0;
+    std::uint32_t source_height = 0;
+    std::uint32_t reserved      = 0;
+};
+static_assert(sizeof(RgbaHeader) == ImageCache::PIXELS_OFFSET);
+
+struct PolarHeader
+{
+    char magic[8] = {'S', 'N', 'P', 'X', 'P', 'O', 'L', 'R'};
+    std::uint32_t version = FORMAT_VERSION;
+    std::uint32_t reserved = 0;
+};
+
+constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull;
+constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+constexpr std::uint64_t P3 = 0x165667B19E3779F9ull;
+
+inline std::uint64_t
+rotl(std::uint64_t x, int r) noexcept
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t
+mix(std::uint64_t acc, std::uint64_t in) noexcept
+{
+    return rotl(acc + in * P2, 31) * P1;
+}
+
+inline std::uint64_t
+read64(const std::uint8_t *p) noexcept
+{
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 64-bit hash of a byte range: four independent multiply-rotate lanes over
+// 32-byte blocks, so hashing a mapped file runs at memory speed.
+std::uint64_t
+hash_bytes(const std::uint8_t *p, std::size_t n) noexcept
+{
+    std::uint64_t lanes[4] = {P1 + P2, P2, 0, 0 - P1};
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+        for (int l = 0; l < 4; ++l)
+            lanes[l] = mix(lanes[l], read64(p + i + 8 * l));
+
+    std::uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7)
+                      + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    h += static_cast<std::uint64_t>(n);
+    for (; i + 8 <= n; i += 8)
+        h = rotl(h ^ mix(0, read64(p + i)), 27) * P1 + P3;
+    for (; i < n; ++i)
+        h = rotl(h ^ (p[i] * P3), 11) * P1;
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace
+
+ImageCache::ImageCache(std::filesystem::path dir, std::uintmax_t max_bytes)
+    : m_dir(std::move(dir)), m_max_bytes(max_bytes)
+{
+}
+
+std::filesystem::path
+ImageCache::default_dir()
+{
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::filesystem::path(xdg) / "sonopix";
+    if (const char *home = std::getenv("HOME"); home && *home)
+        return std::filesystem::path(home) / ".cache" / "sonopix";
+    return std::filesystem::temp_directory_path() / "sonopix";
+}
+
+std::uint64_t
+ImageCache::key(const std::uint8_t *data, std::size_t size,
+                const sonify::ScanShape &shape) noexcept
+{
+    std::uint64_t k = hash_bytes(data, size);
+    k = mix(k, FORMAT_VERSION);
+    // The shape only matters when it can shrink the image
+    if (shape.max_strips > 0 && !shape.tiles)
+    {
+        std::uint32_t angle_bits;
+        std::memcpy(&angle_bits, &shape.scan_angle, sizeof(angle_bits));
+        k = mix(k, static_cast<std::uint64_t>(shape.max_strips));
+        k = mix(k, static_cast<std::uint64_t>(shape.direction));
+        if (shape.direction == sonify::Direction::ANGLE)
+            k = mix(k, angle_bits);
+    }
+    return k;
+}
+
+std::filesystem::path
+ImageCache::entry(std::uint64_t key, const char *ext) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.%s",
+                  static_cast<unsigned long long>(key), ext);
+    return m_dir / name;
+}
+
+std::unique_ptr<MappedFile>
+ImageCache::find_pixels(std::uint64_t key, unsigned &w, unsigned &h,
+                        unsigned &source_w, unsigned &source_h) const noexcept
+{
+    try
+    {
+        const std::filesystem::path path = entry(key, "rgba");
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec))
+            return nullptr;
+
+        auto file = std::make_unique<MappedFile>(path.string());
+        RgbaHeader header;
+        const RgbaHeader expected;
+        if (file->size() < sizeof(header))
+            return nullptr;
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+            || header.version != FORMAT_VERSION
+            || file->size() != PIXELS_OFFSET
+                                   + std::size_t(header.width) * header.height * 4)
+            return nullptr;
+
+        w        = header.width;
+        h        = header.height;
+        source_w = header.source_width;
+        source_h = header.source_height;
+        std::filesystem::last_write_time(
+            path, std::filesystem::file_time_type::clock::now(), ec);
+        return file;
+    }
+    catch (const std::exception &)
+    {
+        return nullptr;
+    }
+}
+
+void
+ImageCache::store_pixels(std::uint64_t key, unsigned w, unsigned h,
+                         unsigned source_w, unsigned source_h,
+                         const std::uint8_t *rgba) const noexcept
+{
+    RgbaHeader header;
+    header.width         = w;
+    header.height        = h;
+    header.source_width  = source_w;
+    header.source_height = source_h;
+    write_entry(entry(key, "rgba"), &header, sizeof(header), rgba,
+                std::size_t(w) * h * 4);
+}
+
+std::vector<std::uint8_t>
+ImageCache::find_polar(std::uint64_t key) const noexcept
+{
+    try
+    {
+        const std::filesystem::path path = entry(key, "polar");
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec))
+            return {};
+
+        const MappedFile file(path.string());
+        PolarHeader header;
+        const PolarHeader expected;
+        if (file.size() <= sizeof(header))
+            return {};
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+            || header.version != FORMAT_VERSION)
+            return {};
+        std::filesystem::last_write_time(
+            path, std::filesystem::file_time_type::clock::now(), ec);
+        return std::vector<std::uint8_t>(file.data() + sizeof(header),
+                                         file.data() + file.size());
+    }
+    catch (const std::exception &)
+    {
+        return {};
+    }
+}
+
+void
+ImageCache::store_polar(std::uint64_t key,
+                        const std::vector<std::uint8_t> &bytes) const noexcept
+{
+    const PolarHeader header;
+    write_entry(entry(key, "polar"), &header, sizeof(header), bytes.data(),
+                bytes.size());
+}
+
+// Writes to a file private to this process, then renames it over `path`,
+// which is atomic within the directory.
+bool
+ImageCache::write_entry(const std::filesystem::path &path, const void *header,
+                        std::size_t header_size, const void *data,
+                        std::size_t size) const noexcept
+{
+    if (header_size + size > m_max_bytes)
+        return false;
+    try
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(m_dir, ec);
+        if (ec)
+            return false;
+
+        std::filesystem::path tmp = path;
+        tmp += ".tmp" + std::to_string(::getpid());
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(static_cast<const char *>(header),
+                      static_cast<std::streamsize>(header_size));
+            out.write(static_cast<const char *>(data),
+                      static_cast<std::streamsize>(size));
+            if (!out.flush())
+            {
+                out.close();
+                std::filesystem::remove(tmp, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        prune();
+        return true;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+// Removes entries, least recently used first, until the directory fits in
+// m_max_bytes. Other runs' temporaries are left alone; an entry still
+// mapped by another run stays readable through its mapping.
+void
+ImageCache::prune() const noexcept
+{
+    struct Entry
+    {
+        std::filesystem::file_time_type used;
+        std::uintmax_t size;
+        std::filesystem::path path;
+    };
+
+    try
+    {
+        std::error_code ec;
+        std::vector<Entry> entries;
+        std::uintmax_t total = 0;
+        for (const auto &de : std::filesystem::directory_iterator(m_dir, ec))
+        {
+            const std::filesystem::path ext = de.path().extension();
+            if (ext != ".rgba" && ext != ".polar")
+                continue;
+            Entry e{de.last_write_time(ec), de.file_size(ec), de.path()};
+            if (ec)
+                continue;
+            total += e.size;
+            entries.push_back(std::move(e));
+        }
+        if (total <= m_max_bytes)
+            return;
+
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry &a, const Entry &b) { return a.used < b.used; });
+        for (const Entry &e : entries)
+        {
+            if (total <= m_max_bytes)
+                break;
+            if (std::filesystem::remove(e.path, ec))
+                total -= e.size;
+        }
+    }
+    catch (const std::exception &)
+    {
+    }
+}
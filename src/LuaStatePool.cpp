@@ -0,0 +1,305 @@
+#include "LuaStatePool.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+void
+call_lua_sonify_func(lua_State *L, const sonify::SonifyContext &ctx,
+                     std::vector<float> &out)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
+    lua_getfield(L, LUA_REGISTRYINDEX, "sonopix_ctx_table");
+
+    lua_pushnumber(L, ctx.sample_rate);
+    lua_setfield(L, -2, "sample_rate");
+    lua_pushnumber(L, ctx.brightness);
+    lua_setfield(L, -2, "brightness");
+    lua_pushnumber(L, ctx.r);
+    lua_setfield(L, -2, "r");
+    lua_pushnumber(L, ctx.g);
+    lua_setfield(L, -2, "g");
+    lua_pushnumber(L, ctx.b);
+    lua_setfield(L, -2, "b");
+    lua_pushnumber(L, ctx.h);
+    lua_setfield(L, -2, "h");
+    lua_pushnumber(L, ctx.s);
+    lua_setfield(L, -2, "s");
+    lua_pushnumber(L, ctx.v);
+    lua_setfield(L, -2, "v");
+    lua_pushnumber(L, ctx.delta);
+    lua_setfield(L, -2, "delta");
+    lua_pushnumber(L, ctx.dr);
+    lua_setfield(L, -2, "dr");
+    lua_pushnumber(L, ctx.dg);
+    lua_setfield(L, -2, "dg");
+    lua_pushnumber(L, ctx.db);
+    lua_setfield(L, -2, "db");
+    lua_pushinteger(L, ctx.x);
+    lua_setfield(L, -2, "x");
+    lua_pushinteger(L, ctx.y);
+    lua_setfield(L, -2, "y");
+    lua_pushinteger(L, ctx.width);
+    lua_setfield(L, -2, "width");
+    lua_pushinteger(L, ctx.height);
+    lua_setfield(L, -2, "height");
+    lua_pushnumber(L, ctx.t);
+    lua_setfield(L, -2, "t");
+    lua_pushnumber(L, std::ldexp(static_cast<double>(ctx.phase >> 11), -53)
+                          * 6.283185307179586);
+    lua_setfield(L, -2, "phase");
+    lua_pushinteger(L, ctx.strip_index);
+    lua_setfield(L, -2, "strip_index");
+    lua_pushinteger(L, ctx.strip_count);
+    lua_setfield(L, -2, "strip_count");
+    lua_pushinteger(L, ctx.chunk_start);
+    lua_setfield(L, -2, "chunk_start");
+    lua_pushinteger(L, static_cast<lua_Integer>(ctx.render_id));
+    lua_setfield(L, -2, "render_id");
+    lua_pushinteger(L, ctx.n_samples);
+    lua_setfield(L, -2, "n_samples");
+    lua_pushnumber(L, ctx.fmin);
+    lua_setfield(L, -2, "fmin");
+    lua_pushnumber(L, ctx.fmax);
+    lua_setfield(L, -2, "fmax");
+
+    const char *scale_str = "linear";
+    if (ctx.freq_scale == sonify::FreqScale::LOG)
+        scale_str = "log";
+    else if (ctx.freq_scale == sonify::FreqScale::EXPONENTIAL)
+        scale_str = "exponential";
+    lua_pushstring(L, scale_str);
+    lua_setfield(L, -2, "scale");
+    lua_pushinteger(L, ctx.channel_count);
+    lua_setfield(L, -2, "channel_count");
+
+    const int total_out = ctx.n_samples * ctx.channel_count;
+
+    if (guarded_pcall(L, 1, 1) != LUA_OK)
+    {
+        if (const ScriptGuard *guard = ScriptGuard::of(L);
+            guard && guard->tripped())
+        {
+            std::string msg = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            throw std::runtime_error("sonify_func aborted at strip "
+                                     + std::to_string(ctx.strip_index) + ": "
+                                     + msg);
+        }
+        fprintf(stderr, "sonify_func error: %s\n", lua_tostring(L, -1));
+        lua_pop(L, 1);
+        for (int i = 0; i < total_out; ++i)
+            out.push_back(0.0f);
+        return;
+    }
+
+    if (!lua_istable(L, -1))
+    {
+        lua_pop(L, 1);
+        for (int i = 0; i < total_out; ++i)
+            out.push_back(0.0f);
+        return;
+    }
+
+    for (int i = 1; i <= total_out; ++i)
+    {
+        lua_rawgeti(L, -1, i);
+        out.push_back(static_cast<float>(lua_tonumber(L, -1)));
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1); // pop result table
+}
+
+namespace
+{
+
+// Reduced `sonopix` table for worker states; see LuaStatePool.
+void
+init_worker_sonopix(lua_State *L, const sonify::SonifyEngine *engine)
+{
+    // opts: plain table; sub-tables are created on first access so that
+    // `sonopix.opts.frequency.min = ...` style assignments don't fail.
+    lua_newtable(L);
+    lua_newtable(L);
+    lua_pushlightuserdata(L, const_cast<sonify::SonifyEngine *>(engine));
+    lua_pushcclosure(L, [](lua_State *L) -> int
+    {
+        const auto *engine = static_cast<const sonify::SonifyEngine *>(
+            lua_touserdata(L, lua_upvalueindex(1)));
+        const char *key = lua_tostring(L, 2);
+        if (!key)
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+        if (strcmp(key, "spu") == 0)
+        {
+            lua_pushnumber(L, engine->secs_per_unit());
+            return 1;
+        }
+        if (strcmp(key, "sample_rate") == 0)
+        {
+            lua_pushnumber(L, engine->sample_rate());
+            return 1;
+        }
+        if (strcmp(key, "channel_count") == 0)
+        {
+            lua_pushinteger(L, engine->channel_count());
+            return 1;
+        }
+        static constexpr const char *sub_tables[]
+            = {"cursor",       "frequency",     "waveform",
+               "oscilloscope", "progress_bar",  "audio_effects",
+               "image_effects"};
+        for (const char *name : sub_tables)
+        {
+            if (strcmp(key, name) == 0)
+            {
+                lua_newtable(L);
+                lua_pushvalue(L, 2);
+                lua_pushvalue(L, -2);
+                lua_rawset(L, 1);
+                return 1;
+            }
+        }
+        lua_pushnil(L);
+        return 1;
+    }, 1);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+    lua_setfield(L, LUA_REGISTRYINDEX, "sonopix_opts");
+
+    lua_newtable(L); // sonopix
+
+    // sonopix.pixel_brightness(x, y) -> number
+    lua_pushlightuserdata(L, const_cast<sonify::SonifyEngine *>(engine));
+    lua_pushcclosure(L, [](lua_State *L) -> int
+    {
+        const auto *engine = static_cast<const sonify::SonifyEngine *>(
+            lua_touserdata(L, lua_upvalueindex(1)));
+        const int x = static_cast<int>(luaL_checkinteger(L, 1));
+        const int y = static_cast<int>(luaL_checkinteger(L, 2));
+        lua_pushnumber(L, engine->pixel_brightness_at(x, y));
+        return 1;
+    }, 1);
+    lua_setfield(L, -2, "pixel_brightness");
+
+    lua_newtable(L); // metatable for sonopix
+
+    // __index: opts from the registry, a no-op function for everything else
+    lua_pushcclosure(L, [](lua_State *L) -> int
+    {
+        const char *key = lua_tostring(L, 2);
+        if (key && strcmp(key, "opts") == 0)
+        {
+            lua_getfield(L, LUA_REGISTRYINDEX, "sonopix_opts");
+            return 1;
+        }
+        lua_pushcclosure(L, [](lua_State *) -> int { return 0; }, 0);
+        return 1;
+    }, 0);
+    lua_setfield(L, -2, "__index");
+
+    // __newindex: `sonopix.opts = { ... }` merges into the opts table
+    lua_pushcclosure(L, [](lua_State *L) -> int
+    {
+        const char *key = lua_tostring(L, 2);
+        if (key && strcmp(key, "opts") == 0 && lua_istable(L, 3))
+        {
+            lua_getfield(L, LUA_REGISTRYINDEX, "sonopix_opts"); // [4]
+            lua_pushnil(L);
+            while (lua_next(L, 3) != 0)
+            {
+                lua_pushvalue(L, -2);
+                lua_pushvalue(L, -2);
+                lua_rawset(L, 4);
+                lua_pop(L, 1);
+            }
+            return 0;
+        }
+        lua_rawset(L, 1);
+        return 0;
+    }, 0);
+    lua_setfield(L, -2, "__newindex");
+
+    lua_setmetatable(L, -2);
+    lua_setglobal(L, "sonopix");
+}
+
+} // namespace
+
+LuaStatePool::~LuaStatePool()
+{
+    clear();
+}
+
+void
+LuaStatePool::clear() noexcept
+{
+    for (lua_State *L : m_states)
+        lua_close(L);
+    m_states.clear();
+    m_guards.clear();
+    m_script_file.clear();
+}
+
+void
+LuaStatePool::load(const std::string &script_file, int count,
+                   const sonify::SonifyEngine *engine)
+{
+    clear();
+    for (int i = 0; i < count; ++i)
+    {
+        lua_State *L = luaL_newstate();
+        luaL_openlibs(L);
+        init_worker_sonopix(L, engine);
+        m_states.push_back(L);
+        m_guards.push_back(std::make_unique<ScriptGuard>());
+        ScriptGuard::install(L, m_guards.back().get());
+
+        if (luaL_dofile(L, script_file.c_str()) != LUA_OK)
+        {
+            std::string error_msg = lua_tostring(L, -1);
+            clear();
+            throw std::runtime_error("Error executing Lua script in worker "
+                                     "state: " + error_msg);
+        }
+
+        // Promote opts.sonify_func to the registry slot that
+        // call_lua_sonify_func() reads, alongside a reusable context table.
+        lua_getfield(L, LUA_REGISTRYINDEX, "sonopix_opts");
+        lua_pushstring(L, "sonify_func");
+        lua_rawget(L, -2);
+        lua_setfield(L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_setfield(L, LUA_REGISTRYINDEX, "sonopix_ctx_table");
+    }
+    m_script_file = script_file;
+}
+
+void
+LuaStatePool::share_budget(const ScriptGuard &guard) noexcept
+{
+    for (auto &g : m_guards)
+        g->share_budget(guard);
+}
+
+std::vector<sonify::SonifyFunc>
+LuaStatePool::sonify_funcs() const
+{
+    std::vector<sonify::SonifyFunc> funcs;
+    funcs.reserve(m_states.size());
+    for (lua_State *L : m_states)
+    {
+        lua_getfield(L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
+        const bool ok = lua_isfunction(L, -1);
+        lua_pop(L, 1);
+        if (!ok)
+            return {};
+        funcs.push_back(
+            [L](const sonify::SonifyContext &ctx, std::vector<float> &out)
+        { call_lua_sonify_func(L, ctx, out); });
+    }
+    return funcs;
+}
@@ -1,6 +1,7 @@
 #include "MainWindow.hpp"
 
 #include "Effects.hpp"
+#include "Expr.hpp"
 #include "lua/init.cpp"
 #include "shaders/image_effects.hpp"
 #include "utils.hpp"
@@ -10,11 +11,15 @@
 #include <SFML/Graphics/VertexArray.hpp>
 #include <SFML/Window/ContextSettings.hpp>
 #include <cmath>
-#include <fstream>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <optional>
 #include <print>
 #include <sys/inotify.h>
 #include <unistd.h>
 #include <webp/decode.h>
+#include <webp/demux.h>
 
 MainWindow::MainWindow() : m_sprite(m_tex)
 {
@@ -27,6 +32,11 @@ MainWindow::MainWindow() : m_sprite(m_tex)
 MainWindow::~MainWindow()
 {
     stop_script_watcher();
+    if (m_sonify_future.valid())
+    {
+        m_sonifier->cancel();
+        m_sonify_future.wait(); // may still be calling into Lua states
+    }
     if (m_L)
     {
         clear_event_listeners();
@@ -122,15 +132,35 @@ MainWindow::read_args(const argparse::ArgumentParser &parser)
         m_sonifier->set_freq_range(fmin, fmax);
     }
 
-    if (parser.is_used("input"))
+    if (parser.is_used("engine"))
     {
-        open_file(parser.get<std::string>("input"));
+        const std::string engine = parser.get<std::string>("engine");
+        if (engine == "spectrogram")
+            m_sonifier->set_engine(sonify::Engine::SPECTROGRAM);
+        else if (engine == "wavetable")
+            m_sonifier->set_engine(sonify::Engine::WAVETABLE);
+        else if (engine == "granular")
+            m_sonifier->set_engine(sonify::Engine::GRANULAR);
+        else
+            m_sonifier->set_engine(sonify::Engine::STRIPS);
     }
 
+    if (parser.is_used("expr"))
+        set_sonify_expr(parser.get<std::string>("expr"));
+
+    if (parser.is_used("call-timeout"))
+        m_cli_script_limits.call_seconds = parser.get<double>("call-timeout");
+    if (parser.is_used("render-timeout"))
+        m_cli_script_limits.render_seconds
+            = parser.get<double>("render-timeout");
+    if (parser.is_used("call-instructions"))
+        m_cli_script_limits.call_instructions
+            = parser.get<long long>("call-instructions");
+
     if (parser.is_used("output"))
     {
         m_output_file = parser.get<std::string>("output");
-        if (m_output_file.find('.') == std::string::npos)
+        if (m_output_file != "-" && m_output_file.find('.') == std::string::npos)
             m_output_file += ".wav";
     }
 
@@ -163,6 +193,9 @@ MainWindow::read_args(const argparse::ArgumentParser &parser)
         else if (dir_str == "rotate-ccw")
             direction = sonify::Direction::ROTATE_CCW;
 
+        else if (dir_str == "angle")
+            direction = sonify::Direction::ANGLE;
+
         else
             throw std::runtime_error("Invalid direction: " + dir_str);
 
@@ -170,14 +203,306 @@ MainWindow::read_args(const argparse::ArgumentParser &parser)
         m_sonifier->set_direction(direction);
     }
 
+    if (parser.is_used("scan-angle"))
+        set_scan_angle(parser.get<float>("scan-angle"));
+
+    if (parser.is_used("cache-size"))
+        m_image_cache.emplace(ImageCache::default_dir(),
+                              std::uintmax_t(std::max(0, parser.get<int>("cache-size")))
+                                  << 20);
+
+    if (parser.get<bool>("no-cache"))
+        m_image_cache.reset();
+
+    if (parser.is_used("max-strips"))
+        m_sonifier->set_max_strips(parser.get<int>("max-strips"));
+
+    if (parser.get<bool>("mmap-output"))
+    {
+        if (m_output_file.empty() || m_output_file == "-"
+            || !m_output_file.ends_with(".wav"))
+        {
+            std::cerr << "--mmap-output needs --output FILE.wav" << std::endl;
+            exit(1);
+        }
+        m_mmap_output = true;
+    }
+
+    if (parser.is_used("pcm-format"))
+    {
+        try
+        {
+            m_pcm_format
+                = PcmWriter::parse_format(parser.get<std::string>("pcm-format"));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+
+    if (parser.is_used("stream"))
+    {
+        try
+        {
+            m_stream_format = FrameStream::Format::parse(
+                parser.get<std::string>("stream"));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+        m_stream_input = parser.get<std::string>("stream-input");
+    }
+
+    if (m_output_file == "-" || m_stream_format)
+        claim_stdout();
+
+    // Opened after the options that decide its analysis size, and before
+    // the window exists, so there is nothing to keep responsive
+    if (parser.is_used("input"))
+    {
+        const std::string input = parser.get<std::string>("input");
+        show_image(decode_file(input, m_sonifier->scan_shape(),
+                               m_image_cache ? &*m_image_cache : nullptr,
+                               m_output_file.empty()));
+    }
+
     if (parser.is_used("cursor-width"))
     {
         m_config.cursor.width = parser.get<float>("cursor-width");
     }
 }
 
+// `-o -` and --stream: stdout carries raw PCM, so keep it for m_pcm_fd
+// alone and point fd 1 at stderr, where LOG(), Lua print() and anything
+// else writing to stdout then goes instead of into the audio. SIGPIPE is
+// ignored so a reader that goes away shows up as a write error, reported
+// and turned into a non-zero exit, rather than killing the process.
 void
-MainWindow::load_image(sf::Image &image, const std::string &filename)
+MainWindow::claim_stdout() noexcept
+{
+    std::fflush(stdout);
+    std::cout.flush();
+    const int fd = ::dup(STDOUT_FILENO);
+    if (fd < 0 || ::dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        std::perror("Failed to redirect stdout");
+        exit(1);
+    }
+    m_pcm_fd = fd;
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+// Box-filter RGBA8 pixels from sw x sh down to dw x dh (dw <= sw, dh <= sh):
+// each output pixel is the mean of the source pixels that fall in its cell.
+static std::unique_ptr<std::uint8_t[]>
+box_downsample(const std::uint8_t *src, int sw, int sh, int dw, int dh)
+{
+    auto out = std::make_unique_for_overwrite<std::uint8_t[]>(
+        static_cast<std::size_t>(dw) * dh * 4);
+
+    std::vector<int> x_edge(static_cast<std::size_t>(dw) + 1);
+    for (int x = 0; x <= dw; ++x)
+        x_edge[x] = static_cast<int>(static_cast<long long>(x) * sw / dw);
+
+    std::vector<std::uint32_t> acc(static_cast<std::size_t>(dw) * 4);
+    for (int y = 0; y < dh; ++y)
+    {
+        const int y0 = static_cast<int>(static_cast<long long>(y) * sh / dh);
+        const int y1 = static_cast<int>(static_cast<long long>(y + 1) * sh / dh);
+        std::fill(acc.begin(), acc.end(), 0u);
+        for (int sy = y0; sy < y1; ++sy)
+        {
+            const std::uint8_t *row = src + static_cast<std::size_t>(sy) * sw * 4;
+            for (int x = 0; x < dw; ++x)
+            {
+                std::uint32_t *a = &acc[static_cast<std::size_t>(x) * 4];
+                for (int sx = x_edge[x]; sx < x_edge[x + 1]; ++sx)
+                {
+                    const std::uint8_t *px = row + static_cast<std::size_t>(sx) * 4;
+                    a[0] += px[0];
+                    a[1] += px[1];
+                    a[2] += px[2];
+                    a[3] += px[3];
+                }
+            }
+        }
+
+        std::uint8_t *dst = out.get() + static_cast<std::size_t>(y) * dw * 4;
+        for (int x = 0; x < dw; ++x)
+        {
+            const std::uint32_t n
+                = static_cast<std::uint32_t>((x_edge[x + 1] - x_edge[x]) * (y1 - y0));
+            for (int c = 0; c < 4; ++c)
+                dst[x * 4 + c] = static_cast<std::uint8_t>((acc[x * 4 + c] + n / 2) / n);
+        }
+    }
+    return out;
+}
+
+// Frames of an animated WebP, composited onto its canvas in display order.
+// The encoded bytes must outlive the decoder.
+class WebPFrames
+{
+public:
+    WebPFrames(const std::uint8_t *data, std::size_t size)
+    {
+        const WebPData webp{data, size};
+        WebPAnimDecoderOptions options;
+        if (!WebPAnimDecoderOptionsInit(&options))
+            throw std::runtime_error("libwebp: animation decoder version mismatch");
+        options.color_mode  = MODE_RGBA;
+        options.use_threads = 1;
+        m_dec = WebPAnimDecoderNew(&webp, &options);
+        if (!m_dec || !WebPAnimDecoderGetInfo(m_dec, &m_info))
+        {
+            WebPAnimDecoderDelete(m_dec);
+            throw std::runtime_error("Failed to decode animated WebP");
+        }
+    }
+    ~WebPFrames() { WebPAnimDecoderDelete(m_dec); }
+
+    WebPFrames(const WebPFrames &)            = delete;
+    WebPFrames &operator=(const WebPFrames &) = delete;
+
+    int width() const noexcept { return static_cast<int>(m_info.canvas_width); }
+    int height() const noexcept { return static_cast<int>(m_info.canvas_height); }
+
+    // RGBA8 canvas after the next frame, valid until the next call; nullptr
+    // after the last frame.
+    const std::uint8_t *next()
+    {
+        std::uint8_t *canvas = nullptr;
+        int timestamp        = 0;
+        if (!WebPAnimDecoderHasMoreFrames(m_dec))
+            return nullptr;
+        if (!WebPAnimDecoderGetNext(m_dec, &canvas, &timestamp))
+            throw std::runtime_error("Failed to decode animated WebP frame");
+        return canvas;
+    }
+
+private:
+    WebPAnimDecoder *m_dec = nullptr;
+    WebPAnimInfo m_info{};
+};
+
+// Frames in a WebP file (1 for stills and anything else)
+static int
+webp_frame_count(const std::string &filename, const MappedFile &file) noexcept
+{
+    if (filename.size() < 5 || filename.substr(filename.size() - 5) != ".webp")
+        return 1;
+    const WebPData webp{file.data(), file.size()};
+    WebPDemuxer *demux = WebPDemux(&webp);
+    if (!demux)
+        return 1;
+    const std::uint32_t frames = WebPDemuxGetI(demux, WEBP_FF_FRAME_COUNT);
+    WebPDemuxDelete(demux);
+    return std::max<int>(1, static_cast<int>(frames));
+}
+
+MainWindow::DecodedImage
+MainWindow::load_image(const std::string &filename, const MappedFile &file,
+                       const sonify::ScanShape &shape)
+{
+    const bool is_webp = filename.size() >= 5
+        && filename.substr(filename.size() - 5) == ".webp";
+
+    DecodedImage out;
+    if (is_webp)
+    {
+        // Decode straight from the mapped file into our own buffer, with
+        // libwebp's filtering thread enabled and, when the sonifier needs
+        // fewer strips than the image has, its scaler shrinking each row as
+        // it is decoded; the buffer is uploaded to the texture and
+        // normalised without another copy.
+        WebPDecoderConfig config;
+        if (!WebPInitDecoderConfig(&config)
+            || WebPGetFeatures(file.data(), file.size(), &config.input)
+                   != VP8_STATUS_OK)
+            throw std::runtime_error("Failed to decode WebP file: " + filename);
+
+        // Animations show their first frame; the rest are decoded as
+        // they are sonified, see sonify_sequence()
+        if (config.input.has_animation)
+        {
+            WebPFrames frames(file.data(), file.size());
+            const std::uint8_t *canvas = frames.next();
+            if (!canvas)
+                throw std::runtime_error("Failed to decode WebP file: " + filename);
+
+            const int fw      = frames.width();
+            const int fh      = frames.height();
+            const auto [w, h] = shape.analysis_size(fw, fh);
+            out.size        = {static_cast<unsigned>(w), static_cast<unsigned>(h)};
+            out.source_size = {static_cast<unsigned>(fw), static_cast<unsigned>(fh)};
+            if (w != fw || h != fh)
+                out.rgba = box_downsample(canvas, fw, fh, w, h);
+            else
+            {
+                const std::size_t bytes = static_cast<std::size_t>(w) * h * 4;
+                out.rgba = std::make_unique_for_overwrite<std::uint8_t[]>(bytes);
+                std::copy_n(canvas, bytes, out.rgba.get());
+            }
+            return out;
+        }
+
+        const auto [w, h] = shape.analysis_size(config.input.width,
+                                                config.input.height);
+        const std::size_t bytes = static_cast<std::size_t>(w) * h * 4;
+        out.size        = {static_cast<unsigned>(w), static_cast<unsigned>(h)};
+        out.source_size = {static_cast<unsigned>(config.input.width),
+                           static_cast<unsigned>(config.input.height)};
+        out.rgba = std::make_unique_for_overwrite<std::uint8_t[]>(bytes);
+
+        if (w != config.input.width || h != config.input.height)
+        {
+            config.options.use_scaling   = 1;
+            config.options.scaled_width  = w;
+            config.options.scaled_height = h;
+        }
+        config.options.use_threads       = 1;
+        config.output.colorspace         = MODE_RGBA;
+        config.output.is_external_memory = 1;
+        config.output.u.RGBA.rgba        = out.rgba.get();
+        config.output.u.RGBA.stride      = w * 4;
+        config.output.u.RGBA.size        = bytes;
+
+        const VP8StatusCode status
+            = WebPDecode(file.data(), file.size(), &config);
+        WebPFreeDecBuffer(&config.output);
+        if (status != VP8_STATUS_OK)
+            throw std::runtime_error("Failed to decode WebP file: " + filename);
+        return out;
+    }
+
+    if (!out.image.loadFromMemory(file.data(), file.size()))
+        throw std::runtime_error("Failed to load image from file: " + filename);
+    out.size        = out.image.getSize();
+    out.source_size = out.size;
+
+    const int fw      = static_cast<int>(out.size.x);
+    const int fh      = static_cast<int>(out.size.y);
+    const auto [w, h] = shape.analysis_size(fw, fh);
+    if (w != fw || h != fh)
+    {
+        out.rgba  = box_downsample(out.image.getPixelsPtr(), fw, fh, w, h);
+        out.size  = {static_cast<unsigned>(w), static_cast<unsigned>(h)};
+        out.image = sf::Image(); // release the full-size pixels
+    }
+    return out;
+}
+
+// Decodes and normalises an image file, or maps its pixels back in from
+// `cache` if given; a miss is stored in it only if `store`. Runs on the
+// loader thread.
+MainWindow::OpenedImage
+MainWindow::decode_file(const std::string &filename,
+                        const sonify::ScanShape &shape,
+                        const ImageCache *cache, bool store)
 {
     std::string fixed_filename = filename;
     if (!fixed_filename.empty() && fixed_filename[0] == '~')
@@ -187,67 +512,179 @@ MainWindow::load_image(sf::Image &image, const std::string &filename)
             fixed_filename.replace(0, 1, home);
     }
 
-    const bool is_webp = fixed_filename.size() >= 5
-        && fixed_filename.substr(fixed_filename.size() - 5) == ".webp";
+    OpenedImage out{filename, fixed_filename, {}, {}, {}, {}, 1};
+    {
+        const MappedFile file(fixed_filename);
+        out.frame_count = webp_frame_count(fixed_filename, file);
+        if (cache)
+        {
+            out.cache_key = ImageCache::key(file.data(), file.size(), shape);
+            unsigned w = 0, h = 0, sw = 0, sh = 0;
+            out.image.cached
+                = cache->find_pixels(*out.cache_key, w, h, sw, sh);
+            out.image.size        = {w, h};
+            out.image.source_size = {sw, sh};
+        }
 
-    if (is_webp)
+        if (!out.image.cached)
+        {
+            out.image = load_image(filename, file, shape);
+            if (cache && store)
+                cache->store_pixels(*out.cache_key, out.image.size.x,
+                                    out.image.size.y, out.image.source_size.x,
+                                    out.image.source_size.y, out.image.pixels());
+        }
+        if (cache)
+            out.polar = cache->find_polar(*out.cache_key);
+    }
+
+    const std::uint8_t *data = out.image.pixels(); // RGBA8, size = w*h*4
+    if (!data)
+        throw std::runtime_error("SFML: getPixelsPtr() returned null");
+
+    const std::size_t size = static_cast<std::size_t>(out.image.size.x)
+                             * out.image.size.y * 4;
+    out.data = sonify::normalize_u8_data(data, size); // normalized to [0 .. 1]
+    return out;
+}
+
+// Opens an image without blocking the event loop: the file is decoded and
+// normalised on a loader thread while the current image stays on screen,
+// and update() swaps it in once it is ready. A request made while another
+// is in flight replaces any request still waiting behind it.
+void
+MainWindow::open_file(const std::string &filename)
+{
+    if (m_open_future.valid())
     {
-        std::ifstream f(fixed_filename, std::ios::binary);
-        if (!f)
-            throw std::runtime_error("Failed to open WebP file: " + filename);
-        std::vector<std::uint8_t> raw(
-            (std::istreambuf_iterator<char>(f)),
-            std::istreambuf_iterator<char>());
+        m_open_queued = filename;
+        return;
+    }
 
-        int w = 0, h = 0;
-        std::uint8_t *pixels = WebPDecodeRGBA(raw.data(), raw.size(), &w, &h);
-        if (!pixels)
-            throw std::runtime_error("Failed to decode WebP file: " + filename);
+    m_open_path   = filename;
+    m_open_future = std::async(std::launch::async,
+                               [filename, shape = m_sonifier->scan_shape(),
+                                cache = m_image_cache,
+                                store = m_output_file.empty()]
+    {
+        return decode_file(filename, shape, cache ? &*cache : nullptr, store);
+    });
+}
 
-        image = sf::Image({static_cast<unsigned>(w), static_cast<unsigned>(h)},
-                          pixels);
-        WebPFree(pixels);
+// Collects the finished open job and shows its image, unless a newer
+// request has been queued behind it.
+void
+MainWindow::finish_open_file() noexcept
+{
+    std::optional<OpenedImage> opened;
+    std::string error;
+    try
+    {
+        opened = m_open_future.get();
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+    }
+
+    if (!m_open_queued.empty())
+    {
+        open_file(std::exchange(m_open_queued, {}));
         return;
     }
 
-    if (!image.loadFromFile(fixed_filename))
-        throw std::runtime_error("Failed to load image from file: " + filename);
+    if (opened)
+    {
+        try
+        {
+            show_image(std::move(*opened));
+            return;
+        }
+        catch (const std::exception &e)
+        {
+            error = e.what();
+        }
+    }
+
+    std::cerr << "open error: " << error << '\n';
+    m_window.setTitle(m_window_title + " [open failed]");
+    m_sonify_after_open = false;
+    fire_event("file_open_failed", {m_open_path, error});
+    if (!m_output_file.empty())
+    {
+        m_exit_code = 1;
+        m_window.close();
+    }
 }
 
+// Stores the polar reductions of the open image in the image cache once a
+// rotate or circle sonification has built them for the whole image, and
+// again when the other direction adds its part. Batch (`-o`) runs leave
+// the cache as they found it.
 void
-MainWindow::open_file(const std::string &filename)
+MainWindow::cache_polar() noexcept
 {
-    sf::Image img;
-    load_image(img, filename);
-    m_tex = sf::Texture(img);
-    m_sprite.setTexture(m_tex, true);
+    if (!m_cache_key || !m_image_cache || !m_output_file.empty())
+        return;
+    const auto bytes = m_sonifier->save_polar(m_cache_version);
+    if (bytes.size() <= m_polar_stored) // nothing new
+        return;
+    m_image_cache->store_polar(*m_cache_key, bytes);
+    m_polar_stored = bytes.size();
+}
 
-    m_win_size  = m_window.isOpen() ? m_window.getSize() : m_window_size;
-    m_tex_size  = img.getSize();
-    const int w = (int)m_tex_size.x;
-    const int h = (int)m_tex_size.y;
+// Main-thread half of opening a file: texture upload, UI re-init and the
+// swap of the sonifier's image.
+void
+MainWindow::show_image(OpenedImage &&opened)
+{
+    const DecodedImage &img = opened.image;
+    const int w = (int)img.size.x;
+    const int h = (int)img.size.y;
 
     if (w <= 0 || h <= 0)
     {
         throw std::runtime_error("SFML: invalid image dimensions");
     }
 
+    m_tex = sf::Texture(img.size);
+    m_tex.update(img.pixels());
+    m_sprite.setTexture(m_tex, true);
+
+    m_win_size = m_window.isOpen() ? m_window.getSize() : m_window_size;
+    m_tex_size = img.size;
+
     float scale = rescale_recenter_image();
     init_cursor(scale);
     init_playback_bar();
     init_waveform();
     init_oscilloscope();
 
-    const std::uint8_t *data = img.getPixelsPtr(); // RGBA8, size = w*h*4
-    if (!data)
-        throw std::runtime_error("SFML: getPixelsPtr() returned null");
-
-    int channels  = 4;
-    auto img_data = sonify::normalize_u8_data(
-        data, w * h * channels); // normalized to [0 .. 1]
-
-    m_sonifier->set_raw_image(w, h, channels, w * 4, std::move(img_data));
+    // A render in flight still reads the image being replaced
+    const bool sonify_now = std::exchange(m_sonify_after_open, false);
+    cancel_sonify();
+
+    int channels = 4;
+    m_sonifier->set_raw_image(w, h, channels, w * 4, std::move(opened.data));
+    // The ROI and ctx.x/y stay in the file's pixels when it was decoded
+    // at a reduced size
+    m_sonifier->set_source_scale(
+        img.source_size.x > 0 ? static_cast<double>(img.source_size.x) / w : 1.0,
+        img.source_size.y > 0 ? static_cast<double>(img.source_size.y) / h : 1.0);
+    m_input_file  = std::move(opened.filename);
+    m_input_path  = std::move(opened.path);
+    m_frame_count = opened.frame_count;
+
+    m_cache_key     = opened.cache_key;
+    m_cache_version = m_sonifier->image_version();
+    m_polar_stored  = 0;
+    if (!opened.polar.empty()
+        && m_sonifier->load_polar(opened.polar.data(), opened.polar.size()))
+        m_polar_stored = opened.polar.size();
     fire_event("file_loaded");
+
+    if (sonify_now)
+        sonify();
 }
 
 void
@@ -394,6 +831,9 @@ MainWindow::handle_keypress_event(const sf::Event::KeyPressed *e) noexcept
         case sf::Keyboard::Key::L:
             set_loop(!m_config.loop);
             break;
+        case sf::Keyboard::Key::Escape:
+            cancel_sonify();
+            break;
         case sf::Keyboard::Key::Left:
             seek_relative(e->shift ? -0.10f : -0.02f);
             break;
@@ -408,10 +848,22 @@ MainWindow::handle_keypress_event(const sf::Event::KeyPressed *e) noexcept
 bool
 MainWindow::sonify()
 {
-    if (m_sonify_future.valid()
-        && m_sonify_future.wait_for(std::chrono::seconds(0))
-               != std::future_status::ready)
-        return false; // already running
+    // Sonify the image being opened rather than the one it replaces
+    if (m_open_future.valid())
+    {
+        m_sonify_after_open = true;
+        return true;
+    }
+
+    // A new request supersedes whatever is in flight; its parameters are
+    // stale by now.
+    cancel_sonify();
+
+    // The render budget covers traversal collection, rendering and
+    // process_func; worker states pick it up in prepare_worker_states().
+    m_script_guard.set_limits(ScriptLimits::tightest(m_config.script_limits,
+                                                     m_cli_script_limits));
+    m_script_guard.start_render();
 
     m_audio_engine->stop();
     m_last_sample_index = 0;
@@ -421,103 +873,559 @@ MainWindow::sonify()
     // grayscale, brightness, contrast, etc. are reflected in the audio.
     snapshot_shaded_image();
 
-    collect_traversal_pixels(); // runs on main thread (Lua not thread-safe);
-                                // fills m_traversal_pixels and
-                                // m_using_custom_traversal
+    // A custom traversal is collected incrementally from update() (Lua is
+    // not thread-safe, so it stays on the main thread, but within a
+    // per-frame budget); rendering starts once it completes.
+    if (!begin_traversal())
+        start_render();
+
+    return true;
+}
+
+// Cancels the traversal collection or render in flight, if any, and waits
+// for the render thread to stop. Returns true if something was cancelled.
+bool
+MainWindow::cancel_sonify() noexcept
+{
+    bool cancelled = std::exchange(m_sonify_after_open, false);
+
+    if (m_traversal_job.active)
+    {
+        m_traversal_job = {};
+        m_traversal.clear();
+        cancelled = true;
+    }
+
+    if (m_sonify_future.valid())
+    {
+        if (m_sonify_future.wait_for(std::chrono::seconds(0))
+            != std::future_status::ready)
+        {
+            m_sonifier->cancel();
+            cancelled = true;
+        }
+        m_sonify_future.wait();
+        m_sonify_future = {};
+        m_process_audio = {}; // a superseded render is not delivered
+    }
+
+    if (cancelled)
+    {
+        m_window.setTitle(m_window_title);
+        fire_event("sonify_cancelled");
+    }
+    return cancelled;
+}
+
+MainWindow::SonifyStatus
+MainWindow::sonify_status() const noexcept
+{
+    SonifyStatus status;
+    if (m_traversal_job.active)
+    {
+        status.phase    = "traversing";
+        status.progress = static_cast<float>(m_traversal_job.next)
+                          / static_cast<float>(m_traversal_job.total);
+    }
+    else if (m_sonify_future.valid())
+    {
+        status.phase    = "rendering";
+        status.progress = m_sonifier->progress();
+        if (status.progress > 0.0f)
+            status.eta = m_render_clock.getElapsedTime().asSeconds()
+                         * (1.0f - status.progress) / status.progress;
+    }
+    return status;
+}
+
+// Reports a sonification that could not complete (e.g. a script that ran
+// out of budget). In batch mode this ends the run with a failure status
+// instead of waiting for audio that will never come.
+void
+MainWindow::fail_sonify(const std::string &error) noexcept
+{
+    std::cerr << "sonify error: " << error << '\n';
+    m_window.setTitle(m_window_title + " [sonify failed]");
+    fire_event("sonify_failed");
+
+    if (!m_output_file.empty())
+    {
+        m_exit_code = 1;
+        m_window.close();
+    }
+}
+
+// Refreshes the title and fires "sonify_progress" when the progress of the
+// current phase has moved by at least a percent.
+void
+MainWindow::report_sonify_progress() noexcept
+{
+    const SonifyStatus status = sonify_status();
+    if (!status.phase)
+        return;
+
+    const int pct = static_cast<int>(status.progress * 100.0f);
+    if (pct == m_last_progress_pct)
+        return;
+    m_last_progress_pct = pct;
+
+    std::string title = m_window_title + " [" + status.phase + " "
+                        + std::to_string(pct) + "%";
+    if (status.eta >= 0.0f)
+        title += ", ~" + std::to_string(static_cast<int>(std::ceil(status.eta)))
+                 + "s left";
+    m_window.setTitle(title + "]");
+
+    fire_event("sonify_progress");
+}
+
+// Main-thread half of a finished render: runs process_func (it needs the
+// main Lua state, which the render thread never touches), hands the audio
+// to playback, fires "sonify_complete" and, with -o, saves the export and
+// closes the window.
+void
+MainWindow::finish_sonify() noexcept
+{
+    try
+    {
+        m_sonify_future.get();
+        if (!m_process_audio.empty())
+        {
+            auto audio_data = std::exchange(m_process_audio, {});
+            const float sr  = m_sonifier->sample_rate();
+            apply_audio_process_func(audio_data, sr);
+            m_audio_engine->set_data(std::move(audio_data), sr);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        m_process_audio = {};
+        fail_sonify(e.what());
+        return;
+    }
+
+    m_window.setTitle(m_window_title);
+    build_waveform();
+    cache_polar();
+    fire_event("sonify_complete");
+
+    if (!m_output_file.empty())
+    {
+        // `-o -` has already streamed it, --mmap-output and the
+        // background encoder written it
+        if (m_output_file != "-" && !m_mmap_output && !m_encoded
+            && !save_audio(m_output_file))
+            m_exit_code = 1;
+        m_window.close();
+    }
+}
 
+void
+MainWindow::start_render() noexcept
+{
     // Reinitialize cursor shape for current mode (custom → point; built-in →
     // line/circle)
     init_cursor(m_sprite.getScale().x);
 
+    try
+    {
+        prepare_worker_states();
+    }
+    catch (const std::exception &e)
+    {
+        fail_sonify(e.what());
+        return;
+    }
+
+    m_sonifier->reset_progress();
+    m_render_clock.restart();
+    m_last_progress_pct = -1;
+    m_encoded           = false;
+
     m_sonify_future
         = std::async(std::launch::async, [this, amp = m_config.amplitude,
-                                          ae = m_config.audio_effects]
+                                          ae     = m_config.audio_effects,
+                                          frames = m_frame_count,
+                                          path   = m_input_path,
+                                          size   = m_tex_size,
+                                          pcm    = m_output_file == "-",
+                                          mapped = m_mmap_output,
+                                          encode = !m_output_file.empty()
+                                                   && m_output_file != "-"]
     {
-        if (!m_using_custom_traversal)
-            m_sonifier->sonify();
-        else
-            m_sonifier->sonify_with_pixels(m_traversal_pixels);
-
-        auto audio_data = m_sonifier->take_audio();
-        if (audio_data.empty())
-            return;
+        const bool sequence = !m_using_custom_traversal && frames > 1
+                              && m_sonifier->engine() == sonify::Engine::STRIPS;
+        auto render = [&]
+        {
+            if (sequence)
+                sonify_sequence(path, frames, size);
+            else if (!m_using_custom_traversal)
+                m_sonifier->sonify();
+            else
+                m_sonifier->sonify_traversal(m_traversal);
+        };
 
         const float sr = m_sonifier->sample_rate();
+        EffectChain effects(ae, amp, sr);
 
-        // Amplitude (legacy) + gain
-        const float total_gain = amp * ae.gain;
-        if (total_gain != 1.0f)
-            Effects::Gain(audio_data, total_gain);
-
-        // Distortion before reverb/delay so it feeds into the wet signal
-        if (ae.distortion_mix > 0.f)
-            audio_data = Effects::Distortion(audio_data, ae.distortion_drive,
-                                             ae.distortion_mix);
+        if (pcm)
+        {
+            render_pcm(render, effects);
+            return;
+        }
+        if (mapped)
+        {
+            render_mapped(render, effects, !sequence);
+            return;
+        }
+        if (encode && !ae.has_process_func)
+        {
+            render_encoded(render, effects);
+            return;
+        }
 
-        if (ae.reverb_mix > 0.f)
-            audio_data = Effects::Reverb(audio_data, sr, ae.reverb_room,
-                                         ae.reverb_damping, ae.reverb_mix);
+        render();
+        auto audio_data = m_sonifier->take_audio();
+        if (audio_data.empty() || m_sonifier->cancelled())
+            return;
 
-        if (ae.delay_mix > 0.f)
-            audio_data = Effects::Delay(audio_data, sr, ae.delay_time,
-                                        ae.delay_feedback, ae.delay_mix);
+        effects.process(audio_data);
 
+        // process_func runs in the main Lua state, so it is left to
+        // finish_sonify() on the main thread
         if (ae.has_process_func)
-            this->apply_audio_process_func(audio_data, sr);
+            m_process_audio = std::move(audio_data);
+        else
+            m_audio_engine->set_data(std::move(audio_data), sr);
+    });
+}
 
-        m_audio_engine->set_data(std::move(audio_data), sr);
+// `-o -`: runs `render` with the engine handing each block of audio through
+// `effects` to stdout as raw PCM as soon as it is rendered, so neither
+// latency nor memory grows with the length of the render. Engines that only
+// render whole buffers are written out at the end. process_func needs the
+// whole buffer and is skipped.
+void
+MainWindow::render_pcm(const std::function<void()> &render,
+                       EffectChain &effects)
+{
+    PcmWriter out(m_pcm_fd, m_pcm_format);
+    m_sonifier->set_audio_sink([&](std::vector<float> &block)
+    {
+        effects.process(block);
+        out.write(block);
     });
+    try
+    {
+        render();
+    }
+    catch (...)
+    {
+        m_sonifier->set_audio_sink({});
+        throw;
+    }
+    m_sonifier->set_audio_sink({});
 
-    return true;
+    auto rest = m_sonifier->take_audio();
+    if (rest.empty() || m_sonifier->cancelled())
+        return;
+    effects.process(rest);
+    out.write(rest);
 }
 
+// `-o FILE` without a process_func: runs `render` with the engine handing
+// each block of audio through `effects` to an encoder thread as soon as it
+// is rendered, so encoding overlaps with synthesis rather than following
+// it. Engines that only render whole buffers are encoded at the end. Sets
+// m_encoded once the file is written; a cancelled, failed or empty render
+// removes it, and a failed write throws so the export exits non-zero.
 void
-MainWindow::collect_traversal_pixels() noexcept
+MainWindow::render_encoded(const std::function<void()> &render,
+                           EffectChain &effects)
 {
-    m_traversal_pixels.clear();
-    m_using_custom_traversal = false;
+    BackgroundEncoder out(m_output_file,
+                          static_cast<unsigned int>(m_sonifier->sample_rate()),
+                          m_sonifier->channel_count());
+    auto discard = [&]
+    {
+        out.finish();
+        std::remove(m_output_file.c_str());
+    };
 
-    if (!m_L)
-        return;
+    m_sonifier->set_audio_sink([&](std::vector<float> &block)
+    {
+        effects.process(block);
+        out.push(block);
+    });
+    try
+    {
+        render();
+        m_sonifier->set_audio_sink({});
 
-    lua_getfield(m_L, LUA_REGISTRYINDEX, "sonopix_traversal_func");
-    if (lua_isnil(m_L, -1))
+        auto rest = m_sonifier->take_audio();
+        if (!m_sonifier->cancelled())
+        {
+            effects.process(rest);
+            out.push(rest);
+        }
+    }
+    catch (...)
     {
-        lua_pop(m_L, 1);
+        m_sonifier->set_audio_sink({});
+        discard();
+        throw;
+    }
+
+    if (m_sonifier->cancelled() || out.sample_count() == 0)
+    {
+        discard();
         return;
     }
+    if (!out.finish())
+    {
+        std::remove(m_output_file.c_str());
+        throw std::runtime_error("Failed to write " + m_output_file);
+    }
+    m_encoded = true;
+}
 
-    const auto &img = m_sonifier->raw_image();
-    if (img.data.empty())
+// --mmap-output: runs `render` with the engine writing its strips in
+// parallel straight into a float WAV mapped at the output path, then runs
+// `effects` over the mapping in place, so the page cache is the only audio
+// buffer. Without `direct` (frame sequences), or with engines that only
+// render whole buffers, the audio is rendered in memory and copied in.
+// process_func needs a buffer of its own and is skipped. A cancelled or
+// failed render removes the file.
+void
+MainWindow::render_mapped(const std::function<void()> &render,
+                          EffectChain &effects, bool direct)
+{
+    const int channels = m_sonifier->channel_count();
+    const auto sr      = static_cast<unsigned int>(m_sonifier->sample_rate());
+    std::unique_ptr<WavMapping> wav;
+    auto discard = [&]
     {
-        lua_pop(m_L, 1);
+        m_sonifier->set_audio_target({});
+        if (wav)
+        {
+            wav.reset();
+            std::remove(m_output_file.c_str());
+        }
+    };
+
+    if (direct)
+    {
+        m_sonifier->set_audio_target([&](std::size_t samples)
+        {
+            wav = std::make_unique<WavMapping>(m_output_file, samples, channels, sr);
+            return wav->samples();
+        });
+    }
+    try
+    {
+        render();
+    }
+    catch (...)
+    {
+        discard();
+        throw;
+    }
+    if (m_sonifier->cancelled())
+    {
+        discard();
         return;
     }
+    m_sonifier->set_audio_target({});
+
+    if (!wav)
+    {
+        auto audio = m_sonifier->take_audio();
+        if (audio.empty())
+            return;
+        wav = std::make_unique<WavMapping>(m_output_file, audio.size(), channels, sr);
+        std::copy(audio.begin(), audio.end(), wav->samples());
+    }
+    effects.process(std::span<float>(wav->samples(), wav->sample_count()));
+}
+
+// Render-thread half of sonifying an animated WebP: decodes its frames one
+// by one, at the size the first one was shown at, and hands them to the
+// engine's pipeline, which reduces and renders earlier frames meanwhile.
+// Image effects and rotation are not applied to the frames.
+void
+MainWindow::sonify_sequence(const std::string &path, int frame_count,
+                            sf::Vector2u size)
+{
+    const MappedFile file(path);
+    WebPFrames frames(file.data(), file.size());
+    const int w = static_cast<int>(size.x);
+    const int h = static_cast<int>(size.y);
+
+    m_sonifier->sonify_frames(frame_count, [&](sonify::RawImage &img)
+    {
+        const std::uint8_t *canvas = frames.next();
+        if (!canvas)
+            return false;
+
+        std::unique_ptr<std::uint8_t[]> small;
+        if (frames.width() != w || frames.height() != h)
+        {
+            small  = box_downsample(canvas, frames.width(), frames.height(), w, h);
+            canvas = small.get();
+        }
+        img.width    = w;
+        img.height   = h;
+        img.channels = 4;
+        img.stride   = w * 4;
+        sonify::normalize_u8_data(canvas, static_cast<std::size_t>(w) * h * 4,
+                                  img.data);
+        return true;
+    });
+}
+
+// Live mode (--stream): sonifies raw frames from m_stream_input as they
+// arrive and plays each one as soon as it is rendered (or writes it to
+// stdout with `-o -`), with no window. The sonify function, scan options
+// and audio effects apply as usual; process_func needs the whole audio and
+// is skipped, as are traversal_func and the non-strip engines. Runs until
+// the input ends.
+int
+MainWindow::run_stream() noexcept
+{
+    if (!m_input_file.empty()
+        || (!m_output_file.empty() && m_output_file != "-"))
+    {
+        std::cerr << "error: --stream cannot be combined with --input, and "
+                     "only with `--output -'\n";
+        return 1;
+    }
+
+    // Per-call limits only: a stream has no end to budget for
+    ScriptLimits limits = ScriptLimits::tightest(m_config.script_limits,
+                                                 m_cli_script_limits);
+    limits.render_seconds = 0.0;
+    m_script_guard.set_limits(limits);
+    m_sonifier->reset_progress();
+
+    try
+    {
+        prepare_worker_states();
+        FrameStream input(m_stream_input, *m_stream_format);
+        EffectChain effects(m_config.audio_effects, m_config.amplitude,
+                            m_sonifier->sample_rate());
+        auto next_frame = [&](sonify::RawImage &img) { return input.read(img); };
+
+        if (m_output_file == "-")
+        {
+            PcmWriter out(m_pcm_fd, m_pcm_format);
+            m_sonifier->sonify_frames(0, next_frame, [&](std::vector<float> &audio)
+            {
+                effects.process(audio);
+                out.write(audio);
+            });
+            return 0;
+        }
+
+        LiveStream live(m_sonifier->sample_rate(), m_sonifier->channel_count());
+        live.play();
+        m_sonifier->sonify_frames(0, next_frame, [&](std::vector<float> &audio)
+        {
+            effects.process(audio);
+            live.push(audio);
+        });
+
+        live.finish();
+        live.wait();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "stream error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+// Starts collecting a custom traversal if `traversal_func` is set. Returns
+// false (and leaves m_using_custom_traversal unset) when there is nothing to
+// collect.
+bool
+MainWindow::begin_traversal() noexcept
+{
+    m_traversal.clear();
+    m_using_custom_traversal = false;
+    m_traversal_job          = {};
+
+    if (!m_L)
+        return false;
+
+    lua_getfield(m_L, LUA_REGISTRYINDEX, "sonopix_traversal_func");
+    const bool has_func = !lua_isnil(m_L, -1);
+    lua_pop(m_L, 1);
+
+    const auto &img = m_sonifier->raw_image();
+    if (!has_func || img.data.empty())
+        return false;
 
-    const int w     = img.width;
-    const int h     = img.height;
-    const int total = w * h;
+    m_traversal.reset(img.width, img.height);
+    m_traversal_job.total  = img.width * img.height;
+    m_traversal_job.active = true;
+    m_last_progress_pct    = -1;
+    return true;
+}
+
+// Calls traversal_func for as many strips as fit in `budget` (a zero budget
+// runs to completion). When the traversal is complete the render is started
+// and true is returned.
+bool
+MainWindow::step_traversal(sf::Time budget) noexcept
+{
+    if (!m_traversal_job.active)
+        return true;
+
+    lua_getfield(m_L, LUA_REGISTRYINDEX, "sonopix_traversal_func");
+
+    const int w     = m_traversal.width();
+    const int h     = m_traversal.height();
+    const int total = m_traversal_job.total;
 
     // Function sits at this absolute stack index throughout the loop.
     const int func_idx = lua_gettop(m_L);
-    m_traversal_pixels.reserve(static_cast<std::size_t>(total));
+    sf::Clock clock;
+    bool failed = false;
 
-    for (int i = 0; i < total; ++i)
+    int &i = m_traversal_job.next;
+    for (; i < total; ++i)
     {
+        // Checking the clock every call would dominate cheap functions
+        if (budget != sf::Time::Zero && (i & 255) == 0 && i > 0
+            && clock.getElapsedTime() >= budget)
+            break;
+
         lua_pushvalue(m_L, func_idx); // function copy
         lua_pushinteger(m_L, i);      // strip_index
         lua_pushinteger(m_L, total);  // total
         lua_pushinteger(m_L, w);      // width
         lua_pushinteger(m_L, h);      // height
 
-        if (lua_pcall(m_L, 4, 2, 0) != LUA_OK)
+        if (guarded_pcall(m_L, 4, 2) != LUA_OK)
         {
+            if (m_script_guard.tripped())
+            {
+                const std::string error
+                    = "traversal_func aborted at strip " + std::to_string(i)
+                      + ": " + lua_tostring(m_L, -1);
+                lua_pop(m_L, 2); // pop error and function
+                m_traversal_job = {};
+                m_traversal.clear();
+                fail_sonify(error);
+                return true;
+            }
             fprintf(stderr, "traversal_func error at strip %d: %s\n", i,
                     lua_tostring(m_L, -1));
             lua_pop(m_L, 1); // pop error
-            m_traversal_pixels.clear();
-            lua_pop(m_L, 1); // pop function
-            return;
+            m_traversal.clear();
+            failed = true;
+            break;
         }
 
         const int x = static_cast<int>(lua_tointeger(m_L, -2));
@@ -525,16 +1433,112 @@ MainWindow::collect_traversal_pixels() noexcept
         lua_pop(m_L, 2);
 
         if (x >= 0 && x < w && y >= 0 && y < h)
-            m_traversal_pixels.emplace_back(x, y);
+            m_traversal.push(x, y);
     }
 
     lua_pop(m_L, 1); // pop function
-    m_using_custom_traversal = !m_traversal_pixels.empty();
+
+    if (!failed && i < total)
+    {
+        report_sonify_progress();
+        return false;
+    }
+
+    m_traversal_job.active = false;
+    m_traversal.shrink_to_fit();
+    m_using_custom_traversal = !m_traversal.empty();
+    m_window.setTitle(m_window_title + " [sonifying...]");
+    start_render();
+    return true;
+}
+
+void
+MainWindow::set_voice(const std::optional<sonify::VoiceParams> &voice) noexcept
+{
+    m_config.voice = voice;
+    m_config.sonify_expr.clear();
+    if (voice)
+    {
+        // The voice replaces any Lua sonify_func, in worker states too
+        if (m_L)
+        {
+            lua_pushnil(m_L);
+            lua_setfield(m_L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
+        }
+        m_sonifier->set_sonify_func(sonify::voices::make(*voice),
+                                    sonify::voices::thread_safe(*voice));
+    }
+    else
+        m_sonifier->set_sonify_func(sonify::sonify_functions::sine(),
+                                    /*thread_safe=*/true);
+}
+
+void
+MainWindow::set_sonify_expr(const std::string &source)
+{
+    if (source.empty())
+    {
+        set_voice(std::nullopt);
+        return;
+    }
+
+    const sonify::Expr expr(source);
+    m_config.voice.reset();
+    m_config.sonify_expr = source;
+    // Like a voice, the expression replaces any Lua sonify_func
+    if (m_L)
+    {
+        lua_pushnil(m_L);
+        lua_setfield(m_L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
+    }
+    m_sonifier->set_sonify_func(expr.func(), /*thread_safe=*/true);
+}
+
+// A Lua sonify_func always renders on LuaStatePool states, never on the
+// main state, which the event loop keeps using while the render thread
+// runs: one state for a serial render, `sonify_threads` to split the strips
+// between. The pool is rebuilt only when the script or thread count
+// changes. Throws std::runtime_error if the states cannot provide the
+// function, which fails the render.
+void
+MainWindow::prepare_worker_states()
+{
+    bool custom = false;
+    if (m_L)
+    {
+        lua_getfield(m_L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
+        custom = lua_isfunction(m_L, -1);
+        lua_pop(m_L, 1);
+    }
+
+    if (!custom)
+    {
+        m_lua_pool.clear();
+        m_sonifier->set_worker_funcs({});
+        return;
+    }
+
+    const int n = std::max(1, m_config.sonify_threads);
+    if (!m_lua_pool.matches(m_script_file, n))
+    {
+        // The current functions belong to the states being replaced
+        m_sonifier->set_worker_funcs({});
+        m_lua_pool.load(m_script_file, n, m_sonifier.get());
+    }
+
+    m_lua_pool.share_budget(m_script_guard);
+    auto funcs = m_lua_pool.sonify_funcs();
+    if (funcs.empty())
+        throw std::runtime_error("sonify_func: the script must set "
+                                 "sonopix.opts.sonify_func at top level");
+    m_sonifier->set_worker_funcs(std::move(funcs));
 }
 
+// Throws std::runtime_error if process_func is aborted by the script guard;
+// other errors leave the audio unprocessed.
 void
 MainWindow::apply_audio_process_func(std::vector<float> &audio_data,
-                                     float sample_rate) noexcept
+                                     float sample_rate)
 {
     if (!m_L)
         return;
@@ -557,8 +1561,14 @@ MainWindow::apply_audio_process_func(std::vector<float> &audio_data,
     // Push sample_rate as second argument
     lua_pushnumber(m_L, sample_rate);
 
-    if (lua_pcall(m_L, 2, 1, 0) != LUA_OK)
+    if (guarded_pcall(m_L, 2, 1) != LUA_OK)
     {
+        if (m_script_guard.tripped())
+        {
+            std::string error = lua_tostring(m_L, -1);
+            lua_pop(m_L, 1);
+            throw std::runtime_error("process_func aborted: " + error);
+        }
         fprintf(stderr, "audio_effects.process_func error: %s\n",
                 lua_tostring(m_L, -1));
         lua_pop(m_L, 1);
@@ -584,8 +1594,12 @@ MainWindow::apply_audio_process_func(std::vector<float> &audio_data,
 bool
 MainWindow::save_audio(const std::string &filename) noexcept
 {
+    step_traversal(sf::Time::Zero);
     if (m_sonify_future.valid())
+    {
         m_sonify_future.wait();
+        finish_sonify();
+    }
     return m_audio_engine->save(filename);
 }
 
@@ -816,6 +1830,14 @@ MainWindow::update_playback_bar() noexcept
     if (!m_config.progress_bar.visible || !m_playback_bar || !m_playback_fill)
         return;
 
+    if (const SonifyStatus status = sonify_status(); status.phase)
+    {
+        const float progress = status.progress;
+        m_playback_fill->setSize({progress * m_playback_bar->getSize().x,
+                                  m_playback_fill->getSize().y});
+        return;
+    }
+
     const std::size_t total = m_audio_engine->sound_buffer().getSampleCount();
     if (total == 0)
         return;
@@ -911,6 +1933,17 @@ MainWindow::init_cursor(float scale, sf::Vector2<float> position) noexcept
         }
         break;
 
+        case sonify::Direction::ANGLE:
+        {
+            // Positioned and sized per strip in move_cursor()
+            auto rect = std::make_unique<sf::RectangleShape>();
+            rect->setFillColor(m_config.cursor.color);
+            rect->setRotation(sf::degrees(m_config.scan_angle));
+            rect->setPosition(m_sprite.getPosition());
+            m_cursor = std::move(rect);
+        }
+        break;
+
         default:
             break;
     }
@@ -1019,13 +2052,25 @@ MainWindow::reset_script_state() noexcept
     m_config.oscilloscope   = OscilloscopeOpts{};
     m_config.amplitude      = 1.0f;
     m_config.direction      = sonify::Direction::LEFT_TO_RIGHT;
+    m_config.scan_angle     = 0.f;
     m_config.image_rotation = 0.f;
     m_config.loop           = false;
     m_config.fps_limit      = 60;
+    m_config.sonify_threads = 1;
+    m_config.script_limits  = ScriptLimits{};
+    m_config.voice.reset();
+    m_config.sonify_expr.clear();
 
     // Propagate to subsystems.
-    m_sonifier->set_sonify_func(sonify::sonify_functions::sine());
+    m_sonifier->set_sonify_func(sonify::sonify_functions::sine(),
+                                /*thread_safe=*/true);
     m_sonifier->set_direction(sonify::Direction::LEFT_TO_RIGHT);
+    m_sonifier->set_scan_angle(0.f);
+    m_sonifier->set_engine(sonify::Engine::STRIPS);
+    m_sonifier->set_spectrogram_opts({});
+    m_sonifier->set_granular_opts({});
+    m_sonifier->set_memoize_levels(0);
+    m_sonifier->set_max_strips(0);
     m_sonifier->set_channel_count(1);
     m_audio_engine->set_channel_count(1);
     m_audio_engine->set_looping(false);
@@ -1075,18 +2120,21 @@ MainWindow::set_effect_grayscale(bool value) noexcept
         sync_shader();
 }
 
-void
+int
 MainWindow::main_loop()
 {
+    if (m_stream_format)
+        return run_stream();
+
     create_window();
     init_image_shader();
 
     if (!m_output_file.empty())
     {
-        if (m_sonifier->raw_image().data.empty())
+        if (m_sonifier->raw_image().data.empty() && !m_open_future.valid())
         {
             std::cerr << "error: --output requires --input\n";
-            return;
+            return 1;
         }
         sonify(); // batch mode: sonify immediately, save when done, then close
     }
@@ -1097,6 +2145,8 @@ MainWindow::main_loop()
         render();
         update();
     }
+
+    return m_exit_code;
 }
 
 void
@@ -1146,12 +2196,22 @@ MainWindow::update() noexcept
     if (m_hot_reload_script
         && m_script_changed.exchange(false, std::memory_order_relaxed))
     {
+        if (m_sonify_future.valid())
+            m_sonify_future.wait(); // don't close states under the renderer
+        if (m_traversal_job.active)
+        {
+            // The traversal_func being stepped belongs to the old state
+            m_traversal_job = {};
+            m_traversal.clear();
+            m_window.setTitle(m_window_title);
+        }
         if (m_L)
         {
             clear_event_listeners();
             lua_close(m_L);
             m_L = nullptr;
         }
+        m_lua_pool.clear();
         reset_script_state();
         try
         {
@@ -1163,21 +2223,20 @@ MainWindow::update() noexcept
         }
     }
 
-    if (m_sonify_future.valid()
-        && m_sonify_future.wait_for(std::chrono::seconds(0))
+    if (m_open_future.valid()
+        && m_open_future.wait_for(std::chrono::seconds(0))
                == std::future_status::ready)
-    {
-        m_sonify_future = {};
-        m_window.setTitle(m_window_title);
-        build_waveform();
-        fire_event("sonify_complete");
+        finish_open_file();
 
-        if (!m_output_file.empty())
-        {
-            save_audio(m_output_file);
-            m_window.close();
-        }
-    }
+    if (m_traversal_job.active)
+        step_traversal(TRAVERSAL_FRAME_BUDGET);
+
+    if (m_sonify_future.valid()
+        && m_sonify_future.wait_for(std::chrono::seconds(0))
+               != std::future_status::ready)
+        report_sonify_progress();
+    else if (m_sonify_future.valid())
+        finish_sonify();
 
     const bool now_playing = m_audio_engine->is_playing();
     if (m_was_playing && !now_playing)
@@ -1209,7 +2268,8 @@ MainWindow::stop() noexcept
 }
 
 void
-MainWindow::fire_event(const std::string &name) noexcept
+MainWindow::fire_event(const std::string &name,
+                       const std::vector<std::string> &args) noexcept
 {
     if (!m_L)
         return;
@@ -1219,7 +2279,9 @@ MainWindow::fire_event(const std::string &name) noexcept
     for (int ref : it->second)
     {
         lua_rawgeti(m_L, LUA_REGISTRYINDEX, ref);
-        if (lua_pcall(m_L, 0, 0, 0) != LUA_OK)
+        for (const std::string &arg : args)
+            lua_pushstring(m_L, arg.c_str());
+        if (lua_pcall(m_L, static_cast<int>(args.size()), 0, 0) != LUA_OK)
         {
             std::cerr << "event \"" << name << "\" error: "
                       << lua_tostring(m_L, -1) << '\n';
@@ -1311,16 +2373,18 @@ MainWindow::move_cursor() noexcept
     const int spu
         = std::max(1, static_cast<int>(m_sonifier->sample_rate()
                                        * m_sonifier->secs_per_unit()));
-    const int strip
-        = static_cast<int>(sample_idx / static_cast<std::size_t>(
-              spu * m_sonifier->channel_count()));
+    int strip = static_cast<int>(sample_idx / static_cast<std::size_t>(
+        spu * m_sonifier->channel_count()));
+    // Frame sequences replay the same strips once per frame
+    if (const int per_frame = m_sonifier->frame_strips(); per_frame > 0)
+        strip %= per_frame;
 
-    // Custom traversal: look up pixel from m_traversal_pixels
+    // Custom traversal: look up pixel from m_traversal
     if (m_using_custom_traversal)
     {
-        if (strip < 0 || strip >= static_cast<int>(m_traversal_pixels.size()))
+        if (strip < 0 || strip >= static_cast<int>(m_traversal.size()))
             return;
-        const auto [px, py] = m_traversal_pixels[strip];
+        const auto [px, py] = m_traversal.at(static_cast<std::size_t>(strip));
         auto *rect          = static_cast<sf::RectangleShape *>(m_cursor.get());
         rect->setSize({m_config.cursor.width, m_config.cursor.width});
         rect->setPosition(m_sprite.getTransform().transformPoint(
@@ -1434,6 +2498,28 @@ MainWindow::move_cursor() noexcept
                                 : -angle_deg));
         }
         break;
+
+        case sonify::Direction::ANGLE:
+        {
+            const int   sw    = m_sonifier->raw_image().width;
+            const int   sh    = m_sonifier->raw_image().height;
+            const float ow    = sw > 0 ? static_cast<float>(sw) : m_tex_size.x;
+            const float oh    = sh > 0 ? static_cast<float>(sh) : m_tex_size.y;
+            const float scale = m_sprite.getScale().x;
+            const sonify::AngleScan scan = m_sonifier->angle_scan();
+            const auto [x, y] = scan.centre(std::clamp(strip, 0, std::max(0, scan.count - 1)));
+            // The line across the whole image, perpendicular to the scan
+            const float length = (ow * std::abs(scan.uy) + oh * std::abs(scan.ux)) * scale;
+            const sf::Vector2f pos = m_sprite.getPosition();
+
+            auto *rect = static_cast<sf::RectangleShape *>(m_cursor.get());
+            rect->setSize({m_config.cursor.width, length});
+            rect->setOrigin({m_config.cursor.width * 0.5f, length * 0.5f});
+            rect->setRotation(sf::degrees(m_config.scan_angle));
+            rect->setPosition({pos.x + (x + 0.5f - ow * 0.5f) * scale,
+                               pos.y + (y + 0.5f - oh * 0.5f) * scale});
+        }
+        break;
     }
 }
 
@@ -1456,7 +2542,8 @@ MainWindow::set_cursor_width(float w) noexcept
     else if (m_config.direction == sonify::Direction::LEFT_TO_RIGHT
              || m_config.direction == sonify::Direction::RIGHT_TO_LEFT
              || m_config.direction == sonify::Direction::ROTATE_CW
-             || m_config.direction == sonify::Direction::ROTATE_CCW)
+             || m_config.direction == sonify::Direction::ROTATE_CCW
+             || m_config.direction == sonify::Direction::ANGLE)
         rect->setSize({w, size.y}); // w = thin dimension, keep length
     else
         rect->setSize({size.x, w});
@@ -0,0 +1,98 @@
+#include "ScriptGuard.hpp"
+
+#include <cstring>
+
+void
+ScriptGuard::install(lua_State *L, ScriptGuard *guard) noexcept
+{
+    std::memcpy(lua_getextraspace(L), &guard, sizeof(guard));
+    // The hook stays installed so limits can change between calls; it
+    // returns immediately outside guarded_pcall().
+    if (guard)
+        lua_sethook(L, &ScriptGuard::hook, LUA_MASKCOUNT, HOOK_INTERVAL);
+    else
+        lua_sethook(L, nullptr, 0, 0);
+}
+
+ScriptGuard *
+ScriptGuard::of(lua_State *L) noexcept
+{
+    ScriptGuard *guard;
+    std::memcpy(&guard, lua_getextraspace(L), sizeof(guard));
+    return guard;
+}
+
+void
+ScriptGuard::set_limits(const ScriptLimits &limits) noexcept
+{
+    m_limits = limits;
+}
+
+void
+ScriptGuard::start_render(Clock::time_point now) noexcept
+{
+    m_render_deadline = Clock::time_point::max();
+    if (m_limits.render_seconds > 0.0)
+        m_render_deadline
+            = now
+              + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(m_limits.render_seconds));
+}
+
+void
+ScriptGuard::share_budget(const ScriptGuard &other) noexcept
+{
+    m_limits          = other.m_limits;
+    m_render_deadline = other.m_render_deadline;
+}
+
+void
+ScriptGuard::begin_call() noexcept
+{
+    m_instructions  = 0;
+    m_tripped       = nullptr;
+    m_call_deadline = Clock::time_point::max();
+    if (m_limits.call_seconds > 0.0)
+        m_call_deadline
+            = Clock::now()
+              + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(m_limits.call_seconds));
+}
+
+void
+ScriptGuard::hook(lua_State *L, lua_Debug *)
+{
+    ScriptGuard *guard = of(L);
+    if (!guard || !guard->m_armed)
+        return; // top-level script code and event handlers run unguarded
+
+    guard->m_instructions += HOOK_INTERVAL;
+    if (guard->m_limits.call_instructions > 0
+        && guard->m_instructions > guard->m_limits.call_instructions)
+        guard->m_tripped = "instruction budget exceeded";
+    else
+    {
+        const auto now = Clock::now();
+        if (now >= guard->m_call_deadline)
+            guard->m_tripped = "call timeout exceeded";
+        else if (now >= guard->m_render_deadline)
+            guard->m_tripped = "render timeout exceeded";
+    }
+
+    if (guard->m_tripped)
+        luaL_error(L, "%s", guard->m_tripped);
+}
+
+int
+guarded_pcall(lua_State *L, int nargs, int nresults)
+{
+    ScriptGuard *guard = ScriptGuard::of(L);
+    if (!guard)
+        return lua_pcall(L, nargs, nresults, 0);
+
+    guard->begin_call();
+    guard->m_armed = true;
+    const int status = lua_pcall(L, nargs, nresults, 0);
+    guard->m_armed = false;
+    return status;
+}
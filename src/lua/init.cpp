@@ -1,3 +1,4 @@
+#include "LuaStatePool.hpp"
 #include "MainWindow.hpp"
 #include "utils.hpp"
 
@@ -9,6 +10,7 @@ MainWindow::init_lua(const std::string &script_file)
 {
     m_L = luaL_newstate();
     luaL_openlibs(m_L);
+    ScriptGuard::install(m_L, &m_script_guard);
 
     init_lua_sonopix();
     init_lua_sonopix_opts();
@@ -27,6 +29,10 @@ MainWindow::init_lua_sonopix() noexcept
     lua_newtable(m_L);
 
     // sonopix.open_file(filepath: str) -> boolean
+    // Queues the file to be decoded in the background and returns whether it
+    // was queued, not whether it opened: "file_loaded" fires once the image
+    // is shown, "file_open_failed" (path, error) if it cannot be, and a
+    // sonify() called meanwhile waits for it.
     lua_pushlightuserdata(m_L, this);
     lua_pushcclosure(m_L, [](lua_State *L) -> int
     {
@@ -40,8 +46,9 @@ MainWindow::init_lua_sonopix() noexcept
         }
         catch (const std::exception &e)
         {
+            // The loader thread could not be started
+            std::cerr << "open error: " << e.what() << '\n';
             lua_pushboolean(L, 0);
-            return luaL_error(L, "Error opening file: %s", e.what());
         }
         return 1;
     }, 1);
@@ -83,6 +90,39 @@ MainWindow::init_lua_sonopix() noexcept
     }, 1);
     lua_setfield(m_L, -2, "sonify");
 
+    // sonopix.cancel_sonify() -> boolean
+    lua_pushlightuserdata(m_L, this);
+    lua_pushcclosure(m_L, [](lua_State *L) -> int
+    {
+        MainWindow *window
+            = static_cast<MainWindow *>(lua_touserdata(L, lua_upvalueindex(1)));
+        lua_pushboolean(L, window->cancel_sonify() ? 1 : 0);
+        return 1;
+    }, 1);
+    lua_setfield(m_L, -2, "cancel_sonify");
+
+    // sonopix.sonify_progress() -> progress, eta, phase | nil
+    lua_pushlightuserdata(m_L, this);
+    lua_pushcclosure(m_L, [](lua_State *L) -> int
+    {
+        MainWindow *window
+            = static_cast<MainWindow *>(lua_touserdata(L, lua_upvalueindex(1)));
+        const auto status = window->sonify_status();
+        if (!status.phase)
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+        lua_pushnumber(L, status.progress);
+        if (status.eta >= 0.0f)
+            lua_pushnumber(L, status.eta);
+        else
+            lua_pushnil(L);
+        lua_pushstring(L, status.phase);
+        return 3;
+    }, 1);
+    lua_setfield(m_L, -2, "sonify_progress");
+
     // sonopix.play()
     lua_pushlightuserdata(m_L, this);
     lua_pushcclosure(m_L, [](lua_State *L) -> int
@@ -163,7 +203,9 @@ MainWindow::init_lua_sonopix() noexcept
     lua_setfield(m_L, -2, "is_stopped");
 
     // sonopix.on(event: string, fn: function)
-    // Events: "sonify_complete", "file_loaded", "playback_end"
+    // Events: "sonify_complete", "sonify_progress", "sonify_cancelled",
+    //         "sonify_failed", "file_loaded", "file_open_failed" (called
+    //         with the path and the error), "playback_end"
     lua_pushlightuserdata(m_L, this);
     lua_pushcclosure(m_L, [](lua_State *L) -> int
     {
@@ -342,6 +384,8 @@ handle_lua_option(lua_State *L, const char *key, const char *value) noexcept
             direction = sonify::Direction::ROTATE_CW;
         else if (strcmp(dir_str, "rotate-ccw") == 0)
             direction = sonify::Direction::ROTATE_CCW;
+        else if (strcmp(dir_str, "angle") == 0)
+            direction = sonify::Direction::ANGLE;
         else
             return luaL_error(L, "Invalid direction: %s", dir_str);
 
@@ -349,6 +393,119 @@ handle_lua_option(lua_State *L, const char *key, const char *value) noexcept
         return 0;
     }
 
+    // sonopix.opts.scan_angle
+    if (strcmp(key, "scan_angle") == 0)
+    {
+        window->set_scan_angle(static_cast<float>(luaL_checknumber(L, 3)));
+        return 0;
+    }
+
+    // sonopix.opts.engine
+    if (strcmp(key, "engine") == 0)
+    {
+        const char *engine_str = luaL_checkstring(L, 3);
+        if (strcmp(engine_str, "strips") == 0)
+            sonifier->set_engine(sonify::Engine::STRIPS);
+        else if (strcmp(engine_str, "spectrogram") == 0)
+            sonifier->set_engine(sonify::Engine::SPECTROGRAM);
+        else if (strcmp(engine_str, "wavetable") == 0)
+            sonifier->set_engine(sonify::Engine::WAVETABLE);
+        else if (strcmp(engine_str, "granular") == 0)
+            sonifier->set_engine(sonify::Engine::GRANULAR);
+        else
+            return luaL_error(L, "Invalid engine: %s", engine_str);
+        return 0;
+    }
+
+    // sonopix.opts.spectrogram = { fft_size, griffin_lim }
+    if (strcmp(key, "spectrogram") == 0)
+    {
+        if (!lua_istable(L, 3))
+            return luaL_error(L, "spectrogram must be a table");
+        sonify::SpectrogramOpts opts = sonifier->spectrogram_opts();
+        lua_getfield(L, 3, "fft_size");
+        if (lua_isnumber(L, -1))
+            opts.fft_size = static_cast<int>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "griffin_lim");
+        if (lua_isnumber(L, -1))
+            opts.griffin_lim = static_cast<int>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+        if (opts.fft_size < 0 || opts.fft_size > (1 << 20))
+            return luaL_error(L, "spectrogram.fft_size must be in [0, 2^20]");
+        if (opts.griffin_lim < 0)
+            return luaL_error(L, "spectrogram.griffin_lim must be >= 0");
+        sonifier->set_spectrogram_opts(opts);
+        return 0;
+    }
+
+    // sonopix.opts.granular = { tile, density, grain_min, grain_max, jitter }
+    if (strcmp(key, "granular") == 0)
+    {
+        if (!lua_istable(L, 3))
+            return luaL_error(L, "granular must be a table");
+        sonify::GranularOpts opts = sonifier->granular_opts();
+        lua_getfield(L, 3, "tile");
+        if (lua_isnumber(L, -1))
+            opts.tile = static_cast<int>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "density");
+        if (lua_isnumber(L, -1))
+            opts.density = static_cast<float>(lua_tonumber(L, -1));
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "grain_min");
+        if (lua_isnumber(L, -1))
+            opts.grain_min = static_cast<float>(lua_tonumber(L, -1));
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "grain_max");
+        if (lua_isnumber(L, -1))
+            opts.grain_max = static_cast<float>(lua_tonumber(L, -1));
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "jitter");
+        if (lua_isnumber(L, -1))
+            opts.jitter = static_cast<float>(lua_tonumber(L, -1));
+        lua_pop(L, 1);
+        if (opts.tile < 1)
+            return luaL_error(L, "granular.tile must be >= 1");
+        if (opts.density < 0.0f)
+            return luaL_error(L, "granular.density must be >= 0");
+        if (opts.grain_min <= 0.0f || opts.grain_max < opts.grain_min
+            || opts.grain_max > 10.0f)
+            return luaL_error(L, "granular grain lengths must satisfy "
+                                 "0 < grain_min <= grain_max <= 10");
+        if (opts.jitter < 0.0f || opts.jitter > 1.0f)
+            return luaL_error(L, "granular.jitter must be in [0, 1]");
+        sonifier->set_granular_opts(opts);
+        return 0;
+    }
+
+    // sonopix.opts.memoize = true | false | levels
+    if (strcmp(key, "memoize") == 0)
+    {
+        if (lua_isboolean(L, 3) || lua_isnil(L, 3))
+        {
+            sonifier->set_memoize_levels(lua_toboolean(L, 3) ? 256 : 0);
+            return 0;
+        }
+        if (!lua_isinteger(L, 3))
+            return luaL_error(L, "memoize must be a boolean or an integer");
+        const lua_Integer levels = lua_tointeger(L, 3);
+        if (levels != 0 && (levels < 2 || levels > 65536))
+            return luaL_error(L, "memoize levels must be 0 or in [2, 65536]");
+        sonifier->set_memoize_levels(static_cast<int>(levels));
+        return 0;
+    }
+
+    // sonopix.opts.max_strips
+    if (strcmp(key, "max_strips") == 0)
+    {
+        const lua_Integer n = luaL_checkinteger(L, 3);
+        if (n < 0)
+            return luaL_error(L, "max_strips must be >= 0");
+        sonifier->set_max_strips(static_cast<int>(n));
+        return 0;
+    }
+
     // sonopix.opts.channel_count
     if (strcmp(key, "channel_count") == 0)
     {
@@ -459,6 +616,7 @@ handle_lua_option(lua_State *L, const char *key, const char *value) noexcept
         if (!lua_isfunction(L, 3))
             return luaL_error(L, "sonify_func must be a function");
 
+        window->set_voice(std::nullopt);
         lua_pushvalue(L, 3);
         lua_setfield(L, LUA_REGISTRYINDEX, "sonopix_sonify_func");
 
@@ -466,88 +624,137 @@ handle_lua_option(lua_State *L, const char *key, const char *value) noexcept
         lua_newtable(L);
         lua_setfield(L, LUA_REGISTRYINDEX, "sonopix_ctx_table");
 
-        lua_State *Lc = L;
+        // Rendered on LuaStatePool states (prepare_worker_states()), never
+        // on this one: the event loop keeps using it while a render runs
         window->sonifier()->set_sonify_func(
-            [Lc](const sonify::SonifyContext &ctx, std::vector<float> &out)
-        {
-            lua_getfield(Lc, LUA_REGISTRYINDEX, "sonopix_sonify_func");
-            lua_getfield(Lc, LUA_REGISTRYINDEX, "sonopix_ctx_table");
-
-            lua_pushnumber(Lc, ctx.sample_rate);
-            lua_setfield(Lc, -2, "sample_rate");
-            lua_pushnumber(Lc, ctx.brightness);
-            lua_setfield(Lc, -2, "brightness");
-            lua_pushnumber(Lc, ctx.r);
-            lua_setfield(Lc, -2, "r");
-            lua_pushnumber(Lc, ctx.g);
-            lua_setfield(Lc, -2, "g");
-            lua_pushnumber(Lc, ctx.b);
-            lua_setfield(Lc, -2, "b");
-            lua_pushnumber(Lc, ctx.h);
-            lua_setfield(Lc, -2, "h");
-            lua_pushnumber(Lc, ctx.s);
-            lua_setfield(Lc, -2, "s");
-            lua_pushnumber(Lc, ctx.v);
-            lua_setfield(Lc, -2, "v");
-            lua_pushinteger(Lc, ctx.x);
-            lua_setfield(Lc, -2, "x");
-            lua_pushinteger(Lc, ctx.y);
-            lua_setfield(Lc, -2, "y");
-            lua_pushinteger(Lc, ctx.width);
-            lua_setfield(Lc, -2, "width");
-            lua_pushinteger(Lc, ctx.height);
-            lua_setfield(Lc, -2, "height");
-            lua_pushnumber(Lc, ctx.t);
-            lua_setfield(Lc, -2, "t");
-            lua_pushinteger(Lc, ctx.strip_index);
-            lua_setfield(Lc, -2, "strip_index");
-            lua_pushinteger(Lc, ctx.strip_count);
-            lua_setfield(Lc, -2, "strip_count");
-            lua_pushinteger(Lc, ctx.n_samples);
-            lua_setfield(Lc, -2, "n_samples");
-            lua_pushnumber(Lc, ctx.fmin);
-            lua_setfield(Lc, -2, "fmin");
-            lua_pushnumber(Lc, ctx.fmax);
-            lua_setfield(Lc, -2, "fmax");
-
-            const char *scale_str = "linear";
-            if (ctx.freq_scale == sonify::FreqScale::LOG)
-                scale_str = "log";
-            else if (ctx.freq_scale == sonify::FreqScale::EXPONENTIAL)
-                scale_str = "exponential";
-            lua_pushstring(Lc, scale_str);
-            lua_setfield(Lc, -2, "scale");
-            lua_pushinteger(Lc, ctx.channel_count);
-            lua_setfield(Lc, -2, "channel_count");
-
-            const int total_out = ctx.n_samples * ctx.channel_count;
-
-            if (lua_pcall(Lc, 1, 1, 0) != LUA_OK)
-            {
-                fprintf(stderr, "sonify_func error: %s\n",
-                        lua_tostring(Lc, -1));
-                lua_pop(Lc, 1);
-                for (int i = 0; i < total_out; ++i)
-                    out.push_back(0.0f);
-                return;
-            }
+            [](const sonify::SonifyContext &, std::vector<float> &)
+        { throw std::runtime_error("sonify_func: no Lua worker state loaded"); });
+        return 0;
+    }
 
-            if (!lua_istable(Lc, -1))
+    // sonopix.opts.sonify_expr = "sin(phase) * b" | nil
+    if (strcmp(key, "sonify_expr") == 0)
+    {
+        if (!lua_isnil(L, 3) && !lua_isstring(L, 3))
+            return luaL_error(L, "sonify_expr must be a string or nil");
+        const char *source = lua_isnil(L, 3) ? "" : lua_tostring(L, 3);
+        try
+        {
+            window->set_sonify_expr(source);
+        }
+        catch (const std::exception &e)
+        {
+            return luaL_error(L, "sonify_expr: %s", e.what());
+        }
+        return 0;
+    }
+
+    // sonopix.opts.voice = "fm" | { type = "fm", ratio = ..., ... } | nil
+    if (strcmp(key, "voice") == 0)
+    {
+        if (lua_isnil(L, 3))
+        {
+            window->set_voice(std::nullopt);
+            return 0;
+        }
+        if (!lua_isstring(L, 3) && !lua_istable(L, 3))
+            return luaL_error(L, "voice must be a voice name, a table or nil");
+
+        sonify::VoiceParams voice;
+        if (lua_istable(L, 3))
+            lua_getfield(L, 3, "type");
+        else
+            lua_pushvalue(L, 3);
+        const char *type_str = lua_isnil(L, -1) ? "fm" : lua_tostring(L, -1);
+        if (!type_str)
+            return luaL_error(L, "voice.type must be a string");
+        if (strcmp(type_str, "fm") == 0)
+            voice.type = sonify::VoiceType::FM;
+        else if (strcmp(type_str, "saw") == 0)
+            voice.type = sonify::VoiceType::SAW;
+        else if (strcmp(type_str, "square") == 0)
+            voice.type = sonify::VoiceType::SQUARE;
+        else if (strcmp(type_str, "noise") == 0)
+            voice.type = sonify::VoiceType::NOISE;
+        else
+            return luaL_error(L, "Invalid voice type: %s", type_str);
+        lua_pop(L, 1);
+
+        if (lua_istable(L, 3))
+        {
+            struct { const char *name; float *field; } numbers[] = {
+                {"gain", &voice.gain},
+                {"ratio", &voice.ratio},
+                {"ratio_hue", &voice.ratio_hue},
+                {"index", &voice.index},
+                {"index_saturation", &voice.index_saturation},
+                {"cutoff", &voice.cutoff},
+                {"decay", &voice.decay},
+                {"threshold", &voice.threshold},
+                {"smoothing", &voice.smoothing},
+                {"drone", &voice.drone},
+            };
+            for (const auto &n : numbers)
             {
-                lua_pop(Lc, 1);
-                for (int i = 0; i < total_out; ++i)
-                    out.push_back(0.0f);
-                return;
+                lua_getfield(L, 3, n.name);
+                if (lua_isnumber(L, -1))
+                    *n.field = static_cast<float>(lua_tonumber(L, -1));
+                else if (!lua_isnil(L, -1))
+                    return luaL_error(L, "voice.%s must be a number", n.name);
+                lua_pop(L, 1);
             }
-
-            for (int i = 1; i <= total_out; ++i)
+            lua_getfield(L, 3, "pan");
+            if (lua_isstring(L, -1))
             {
-                lua_rawgeti(Lc, -1, i);
-                out.push_back(static_cast<float>(lua_tonumber(Lc, -1)));
-                lua_pop(Lc, 1);
+                const char *pan = lua_tostring(L, -1);
+                if (strcmp(pan, "x") == 0)
+                    voice.pan_x = true;
+                else if (strcmp(pan, "none") != 0)
+                    return luaL_error(L, "Invalid voice pan: %s", pan);
             }
-            lua_pop(Lc, 1); // pop result table
-        });
+            lua_pop(L, 1);
+        }
+
+        if (voice.ratio <= 0.0f || voice.decay < 0.0f || voice.drone < 0.0f
+            || voice.cutoff < 0.0f)
+            return luaL_error(L, "voice ratio must be > 0 and decay, drone, "
+                                 "cutoff must be >= 0");
+        if (voice.smoothing < 0.0f || voice.smoothing >= 1.0f)
+            return luaL_error(L, "voice.smoothing must be in [0, 1)");
+        window->set_voice(voice);
+        return 0;
+    }
+
+    // sonopix.opts.sonify_threads
+    if (strcmp(key, "sonify_threads") == 0)
+    {
+        int n = static_cast<int>(luaL_checkinteger(L, 3));
+        if (n < 1)
+            return luaL_error(L, "sonify_threads must be >= 1");
+        window->set_sonify_threads(n);
+        return 0;
+    }
+
+    // sonopix.opts.script_limits = { call_instructions, call_seconds,
+    // render_seconds } — omitted fields are disabled
+    if (strcmp(key, "script_limits") == 0)
+    {
+        if (!lua_istable(L, 3))
+            return luaL_error(L, "script_limits must be a table");
+        ScriptLimits limits;
+        lua_getfield(L, 3, "call_instructions");
+        if (lua_isnumber(L, -1))
+            limits.call_instructions = static_cast<long long>(lua_tonumber(L, -1));
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "call_seconds");
+        if (lua_isnumber(L, -1))
+            limits.call_seconds = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "render_seconds");
+        if (lua_isnumber(L, -1))
+            limits.render_seconds = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+        window->set_script_limits(limits);
         return 0;
     }
 
@@ -1364,6 +1571,9 @@ MainWindow::init_lua_sonopix_opts() noexcept
                 case sonify::Direction::ROTATE_CCW:
                     dir_str = "rotate-ccw";
                     break;
+                case sonify::Direction::ANGLE:
+                    dir_str = "angle";
+                    break;
                 default:
                     return luaL_error(L, "Invalid direction enum value");
             }
@@ -1371,6 +1581,13 @@ MainWindow::init_lua_sonopix_opts() noexcept
             return 1;
         }
 
+        // sonopix.opts.scan_angle
+        if (strcmp(key, "scan_angle") == 0)
+        {
+            lua_pushnumber(L, static_cast<lua_Number>(window->scan_angle()));
+            return 1;
+        }
+
         // sonopix.opts.spu
         if (strcmp(key, "spu") == 0)
         {
@@ -1527,6 +1744,133 @@ MainWindow::init_lua_sonopix_opts() noexcept
             return 1;
         }
 
+        // sonopix.opts.sonify_expr
+        if (strcmp(key, "sonify_expr") == 0)
+        {
+            if (window->sonify_expr().empty())
+                lua_pushnil(L);
+            else
+                lua_pushstring(L, window->sonify_expr().c_str());
+            return 1;
+        }
+
+        // sonopix.opts.voice
+        if (strcmp(key, "voice") == 0)
+        {
+            const auto &voice = window->voice();
+            if (!voice)
+            {
+                lua_pushnil(L);
+                return 1;
+            }
+            static constexpr const char *type_names[] = {"fm", "saw", "square", "noise"};
+            lua_newtable(L);
+            lua_pushstring(L, type_names[static_cast<int>(voice->type)]);
+            lua_setfield(L, -2, "type");
+            const std::pair<const char *, float> numbers[] = {
+                {"gain", voice->gain},
+                {"ratio", voice->ratio},
+                {"ratio_hue", voice->ratio_hue},
+                {"index", voice->index},
+                {"index_saturation", voice->index_saturation},
+                {"cutoff", voice->cutoff},
+                {"decay", voice->decay},
+                {"threshold", voice->threshold},
+                {"smoothing", voice->smoothing},
+                {"drone", voice->drone},
+            };
+            for (const auto &[name, value] : numbers)
+            {
+                lua_pushnumber(L, value);
+                lua_setfield(L, -2, name);
+            }
+            lua_pushstring(L, voice->pan_x ? "x" : "none");
+            lua_setfield(L, -2, "pan");
+            return 1;
+        }
+
+        // sonopix.opts.engine
+        if (strcmp(key, "engine") == 0)
+        {
+            switch (window->sonifier()->engine())
+            {
+                case sonify::Engine::SPECTROGRAM: lua_pushstring(L, "spectrogram"); break;
+                case sonify::Engine::WAVETABLE:   lua_pushstring(L, "wavetable");   break;
+                case sonify::Engine::GRANULAR:    lua_pushstring(L, "granular");    break;
+                default:                          lua_pushstring(L, "strips");      break;
+            }
+            return 1;
+        }
+
+        // sonopix.opts.spectrogram
+        if (strcmp(key, "spectrogram") == 0)
+        {
+            const auto &so = window->sonifier()->spectrogram_opts();
+            lua_newtable(L);
+            lua_pushinteger(L, so.fft_size);
+            lua_setfield(L, -2, "fft_size");
+            lua_pushinteger(L, so.griffin_lim);
+            lua_setfield(L, -2, "griffin_lim");
+            return 1;
+        }
+
+        // sonopix.opts.memoize
+        if (strcmp(key, "memoize") == 0)
+        {
+            const int levels = window->sonifier()->memoize_levels();
+            if (levels > 0)
+                lua_pushinteger(L, levels);
+            else
+                lua_pushboolean(L, 0);
+            return 1;
+        }
+
+        // sonopix.opts.max_strips
+        if (strcmp(key, "max_strips") == 0)
+        {
+            lua_pushinteger(L, window->sonifier()->max_strips());
+            return 1;
+        }
+
+        // sonopix.opts.granular
+        if (strcmp(key, "granular") == 0)
+        {
+            const auto &go = window->sonifier()->granular_opts();
+            lua_newtable(L);
+            lua_pushinteger(L, go.tile);
+            lua_setfield(L, -2, "tile");
+            lua_pushnumber(L, go.density);
+            lua_setfield(L, -2, "density");
+            lua_pushnumber(L, go.grain_min);
+            lua_setfield(L, -2, "grain_min");
+            lua_pushnumber(L, go.grain_max);
+            lua_setfield(L, -2, "grain_max");
+            lua_pushnumber(L, go.jitter);
+            lua_setfield(L, -2, "jitter");
+            return 1;
+        }
+
+        // sonopix.opts.script_limits
+        if (strcmp(key, "script_limits") == 0)
+        {
+            const auto &sl = window->script_limits();
+            lua_newtable(L);
+            lua_pushinteger(L, sl.call_instructions);
+            lua_setfield(L, -2, "call_instructions");
+            lua_pushnumber(L, sl.call_seconds);
+            lua_setfield(L, -2, "call_seconds");
+            lua_pushnumber(L, sl.render_seconds);
+            lua_setfield(L, -2, "render_seconds");
+            return 1;
+        }
+
+        // sonopix.opts.sonify_threads
+        if (strcmp(key, "sonify_threads") == 0)
+        {
+            lua_pushinteger(L, window->sonify_threads());
+            return 1;
+        }
+
         lua_pushvalue(L, 2);
         lua_rawget(L, 1);
         return 1;
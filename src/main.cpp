@@ -37,6 +37,28 @@ init_args(argparse::ArgumentParser &parser)
         .implicit_value(true)
         .flag();
 
+    parser.add_argument("--call-timeout")
+        .help("Abort a sonification if a single call into a Lua function "
+              "(sonify_func, traversal_func, process_func) runs longer than "
+              "SECS seconds.")
+        .nargs(1)
+        .scan<'g', double>()
+        .metavar("SECS");
+
+    parser.add_argument("--render-timeout")
+        .help("Abort a sonification if its Lua functions are still running "
+              "SECS seconds after it started.")
+        .nargs(1)
+        .scan<'g', double>()
+        .metavar("SECS");
+
+    parser.add_argument("--call-instructions")
+        .help("Abort a sonification if a single call into a Lua function "
+              "executes more than N VM instructions.")
+        .nargs(1)
+        .scan<'i', long long>()
+        .metavar("N");
+
     parser.add_argument("--verbose")
         .help("Enable verbose output for debugging.")
         .default_value(false)
@@ -45,7 +67,8 @@ init_args(argparse::ArgumentParser &parser)
 
     parser.add_argument("-o", "--output")
         .help("Output file to write audio to (by default, saved as `wav' if no "
-              "extension is specified).")
+              "extension is specified). `-' streams raw PCM to stdout as it "
+              "is rendered (see --pcm-format).")
         .default_value(std::string(""))
         .nargs(1)
         .metavar("FILE");
@@ -95,6 +118,23 @@ init_args(argparse::ArgumentParser &parser)
         return std::make_pair(a, b);
     });
 
+    parser.add_argument("-e", "--engine")
+        .help("Synthesis engine: `strips' (one oscillator or sonify_func call "
+              "per column/row/ring), `spectrogram' (each column or row is "
+              "a magnitude spectrum, rendered by inverse STFT), `wavetable' "
+              "(each column or row is one cycle of a band-limited waveform) "
+              "or `granular' (image tiles seed sine grains).")
+        .default_value(std::string("strips"))
+        .nargs(1)
+        .choices("strips", "spectrogram", "wavetable", "granular")
+        .metavar("ENGINE");
+
+    parser.add_argument("-x", "--expr")
+        .help("Sonify each strip with a math expression instead of the "
+              "built-in sine, e.g. `sin(phase) * b + 0.2 * noise()'.")
+        .nargs(1)
+        .metavar("EXPR");
+
     parser.add_argument("--cursor-width")
         .help("Width of the cursor in pixels.")
         .nargs(1)
@@ -112,13 +152,71 @@ init_args(argparse::ArgumentParser &parser)
     parser.add_argument("-d", "--direction")
         .help("Direction to traverse the image (left-to-right, right-to-left, "
               "top-to-bottom, bottom-to-top, circle-outwards, circle-inwards, "
-              "rotate-cw, rotate-ccw).")
+              "rotate-cw, rotate-ccw, angle).")
         .default_value(std::string("left-to-right"))
         .nargs(1)
         .choices("left-to-right", "right-to-left", "top-to-bottom",
                  "bottom-to-top", "circle-outwards", "circle-inwards",
-                 "rotate-cw", "rotate-ccw")
+                 "rotate-cw", "rotate-ccw", "angle")
         .metavar("DIRECTION");
+
+    parser.add_argument("--scan-angle")
+        .help("Scan direction of `--direction angle' in degrees, clockwise "
+              "from left-to-right (90 = top-to-bottom).")
+        .nargs(1)
+        .scan<'g', float>()
+        .metavar("DEGREES");
+
+    parser.add_argument("--cache-size")
+        .help("Size cap of the cache of decoded images in MiB; the least "
+              "recently used entries are removed to stay under it.")
+        .nargs(1)
+        .scan<'i', int>()
+        .metavar("MIB");
+
+    parser.add_argument("--no-cache")
+        .help("Do not read or write the cache of decoded images in "
+              "~/.cache/sonopix.")
+        .default_value(false)
+        .implicit_value(true)
+        .flag();
+
+    parser.add_argument("--max-strips")
+        .help("Scan the image into at most N strips; larger images are "
+              "decoded at a reduced size with the same aspect ratio.")
+        .nargs(1)
+        .scan<'i', int>()
+        .metavar("N");
+
+    parser.add_argument("--mmap-output")
+        .help("Render straight into the `--output' WAV, memory-mapped at its "
+              "final size, with no audio buffer in memory. Writes 32-bit "
+              "float samples (RF64 beyond 4 GiB); skips process_func.")
+        .default_value(false)
+        .implicit_value(true)
+        .flag();
+
+    parser.add_argument("--pcm-format")
+        .help("Sample format of `--output -' (raw PCM on stdout): s16 or "
+              "f32, interleaved, native byte order.")
+        .default_value(std::string("s16"))
+        .nargs(1)
+        .choices("s16", "f32")
+        .metavar("FORMAT");
+
+    parser.add_argument("--stream")
+        .help("Sonify raw 8-bit frames of this size and layout (gray, rgb "
+              "or rgba) live, as they are read from --stream-input, "
+              "without a window.")
+        .nargs(1)
+        .metavar("WxH[:FORMAT]");
+
+    parser.add_argument("--stream-input")
+        .help("File or named pipe to read --stream frames from (- for "
+              "stdin).")
+        .default_value(std::string("-"))
+        .nargs(1)
+        .metavar("PATH");
 }
 
 int
@@ -141,7 +239,5 @@ main(int argc, char *argv[])
 
     MainWindow mw;
     mw.read_args(parser);
-    mw.main_loop();
-
-    return 0;
+    return mw.main_loop();
 }
@@ -10,13 +10,19 @@ sonopix = sonopix or {}
 ---@field h number Hue in [0, 360]
 ---@field s number HSV saturation in [0, 1]
 ---@field v number HSV value in [0, 1]
+---@field delta number Brightness change since the same strip of the previous animation frame (0 for still images and first frames)
+---@field dr number Red change since the previous animation frame
+---@field dg number Green change since the previous animation frame
+---@field db number Blue change since the previous animation frame
 ---@field x integer Current column (or ring radius for circle modes)
 ---@field y integer Current row
 ---@field width integer Image width in pixels
 ---@field height integer Image height in pixels
 ---@field strip_index integer Playback-order index of this strip (0 = first strip played, direction-independent)
 ---@field strip_count integer Total number of strips
+---@field chunk_start integer First strip of the chunk rendered by this Lua state (0 unless sonify_threads > 1)
 ---@field t number Time in seconds since the start of audio
+---@field phase number Phase in radians [0, 2pi) at strip start of an oscillator that has followed the frequency map since strip 0
 ---@field n_samples integer Frames to generate per strip (samples per channel); return n_samples * channel_count interleaved values
 ---@field channel_count integer Number of audio channels (1 = mono, 2 = stereo)
 ---@field fmin number Minimum frequency in Hz
@@ -66,8 +72,23 @@ sonopix = sonopix or {}
 ---@field distortion? { drive: number, mix: number } Simple distortion effect with drive amount [0, 1] and wet/dry mix [0, 1]
 ---@field process_func? fun(samples: number[], sample_rate: number): number[] Custom post-processing function; receives all audio samples and sample rate, returns modified samples
 
+---@class VoiceOpts
+---@field type? "fm"|"saw"|"square"|"noise" Waveform (default: "fm")
+---@field gain? number Output gain (default: 1)
+---@field ratio? number FM modulator/carrier frequency ratio (default: 2)
+---@field ratio_hue? number Added to ratio times sin(hue / 2) (default: 0)
+---@field index? number FM modulation index in radians (default: 1)
+---@field index_saturation? number Added to index times saturation (default: 0)
+---@field cutoff? number Noise low-pass cutoff in Hz; 0 = the strip's pitch (default: 0)
+---@field decay? number Envelope time constant in seconds; > 0 enables the envelope follower (default: 0)
+---@field threshold? number Brightness above 1.5x the rolling average that re-triggers the envelope (default: 0.02)
+---@field smoothing? number Per-strip weight of the old rolling brightness average, in [0, 1) (default: 0.97)
+---@field drone? number Level of a sine at the pitch of 0.3x the rolling average (default: 0)
+---@field pan? "none"|"x" Stereo pan by strip x (default: "none")
+
 ---@class SonopixOpts
----@field direction? "left-to-right"|"right-to-left"|"top-to-bottom"|"bottom-to-top"|"circle-outwards"|"circle-inwards"|"rotate-cw"|"rotate-ccw" Scan direction
+---@field direction? "left-to-right"|"right-to-left"|"top-to-bottom"|"bottom-to-top"|"circle-outwards"|"circle-inwards"|"rotate-cw"|"rotate-ccw"|"angle" Scan direction
+---@field scan_angle? number Scan direction of "angle" in degrees clockwise from left-to-right (default: 0)
 ---@field frequency? FrequencyOpts Frequency mapping options
 ---@field spu? number Seconds per unit (column or row); must be > 0
 ---@field cursor? SonopixCursorOpts Cursor appearance options
@@ -88,6 +109,15 @@ sonopix = sonopix or {}
 ---@field window_size? { width: integer, height: integer } Window dimensions in pixels
 ---@field traversal_func? fun(strip_index: integer, total: integer, width: integer, height: integer): integer, integer Custom pixel traversal; called once per strip with (strip_index, total, width, height); return (x, y) for that strip
 ---@field sonify_func? fun(ctx: SonifyContext): number[] Custom sonification function; receives context per strip and returns an array of n_samples floats in [-1, 1]
+---@field engine? "strips"|"spectrogram"|"wavetable"|"granular" Synthesis engine (default: "strips"); spectrogram reads each column/row as a magnitude spectrum and renders it by inverse STFT, wavetable plays each column/row as one cycle of a band-limited waveform, granular emits sine grains seeded by image tiles
+---@field spectrogram? { fft_size?: integer, griffin_lim?: integer } Spectrogram engine options: FFT size (0 = automatic) and Griffin-Lim phase iterations (0 = off)
+---@field granular? { tile?: integer, density?: number, grain_min?: number, grain_max?: number, jitter?: number } Granular engine options: tile size in pixels, grains per second per tile at full value, grain length range in seconds, onset jitter in [0, 1]
+---@field voice? "fm"|"saw"|"square"|"noise"|VoiceOpts Native voice played instead of sonify_func (nil = built-in sine)
+---@field sonify_expr? string Math expression compiled into the sonify function instead of sonify_func, e.g. "sin(phase) * b"; ';' separates channels (nil = built-in sine)
+---@field memoize? boolean|integer Reuse the audio of strips whose r/g/b quantize to the same levels (true = 256 levels); only for functions that depend on the strip colour alone (default: false)
+---@field max_strips? integer Largest number of strips a scan may need; images opened afterwards that would give more are decoded at a reduced size (default: 0 = no cap)
+---@field sonify_threads? integer Independent Lua states rendering sonify_func in parallel, one contiguous chunk of strips each (default: 1)
+---@field script_limits? { call_instructions?: integer, call_seconds?: number, render_seconds?: number } Budgets for calls into sonify_func/traversal_func/process_func; a call over budget aborts the sonification (0 or omitted = unlimited)
 
 ---@type SonopixOpts
 sonopix.opts = {}
@@ -1,9 +1,12 @@
 ---@meta
 sonopix = sonopix or {}
 
----Loads an image file and opens it in Sonopix
+---Loads an image file and opens it in Sonopix. The file is decoded in the
+---background while the current image stays on screen; "file_loaded" fires
+---once it is shown, "file_open_failed" (with the path and the error) if it
+---cannot be, and a sonify() called meanwhile waits for it
 ---@param filepath string Path to the image file
----@return boolean success True if the file was successfully opened
+---@return boolean queued True if the open was queued; whether it succeeds is only known from the events
 sonopix.open_file = function(filepath) end
 
 ---Returns the file path of the currently open image, or nil if no file is open
@@ -17,6 +20,17 @@ sonopix.close_file = function() end
 ---@return boolean success True if sonification was successful
 sonopix.sonify = function() end
 
+---Cancels the sonification in progress, if any. Fires the "sonify_cancelled" event.
+---@return boolean cancelled True if a sonification was running
+sonopix.cancel_sonify = function() end
+
+---Returns the progress of the sonification in progress, or nil when idle.
+---`eta` (seconds) is nil until the first strips have rendered.
+---@return number|nil progress Fraction of the current phase done [0, 1]
+---@return number|nil eta Estimated seconds left in the render
+---@return "traversing"|"rendering"|nil phase
+sonopix.sonify_progress = function() end
+
 ---Plays the sonified audio
 sonopix.play = function() end
 
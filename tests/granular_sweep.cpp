@@ -0,0 +1,60 @@
+// Granular sweeps must place a tile's grains where the sweep reaches it:
+// an image bright only at its right edge sounds at the end left to right
+// and at the start right to left.
+#include "SonifyEngine.hpp"
+
+#include <cstdio>
+#include <vector>
+
+using namespace sonify;
+
+// Energy of the first and last fifth of a render
+static std::pair<double, double>
+edge_energy(Direction direction)
+{
+    constexpr int W = 40, H = 16;
+    std::vector<float> pixels(static_cast<std::size_t>(W) * H * 4, 0.0f);
+    for (int y = 0; y < H; ++y)
+        for (int x = 32; x < W; ++x)
+            for (int c = 0; c < 4; ++c)
+                pixels[(static_cast<std::size_t>(y) * W + x) * 4 + c] = 1.0f;
+
+    SonifyEngine engine;
+    engine.set_engine(Engine::GRANULAR);
+    engine.set_direction(direction);
+    engine.set_secs_per_unit(0.01f);
+    engine.set_raw_image(W, H, 4, W * 4, std::move(pixels));
+    engine.sonify();
+
+    const std::vector<float> audio = engine.take_audio();
+    const std::size_t fifth = audio.size() / 5;
+    double first = 0.0, last = 0.0;
+    for (std::size_t i = 0; i < fifth; ++i)
+    {
+        first += audio[i] * audio[i];
+        last += audio[audio.size() - 1 - i] * audio[audio.size() - 1 - i];
+    }
+    return {first, last};
+}
+
+int
+main()
+{
+    int failures = 0;
+    auto expect = [&](bool ok, const char *what)
+    {
+        if (!ok)
+        {
+            std::fprintf(stderr, "FAIL: %s\n", what);
+            ++failures;
+        }
+    };
+
+    const auto [ltr_first, ltr_last] = edge_energy(Direction::LEFT_TO_RIGHT);
+    expect(ltr_first == 0.0 && ltr_last > 0.0, "left to right sounds the right edge last");
+
+    const auto [rtl_first, rtl_last] = edge_energy(Direction::RIGHT_TO_LEFT);
+    expect(rtl_first > 0.0 && rtl_last == 0.0, "right to left sounds the right edge first");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// An image decoded at a reduced analysis size keeps the ROI, ctx.x/y/width
+// and pixel_brightness() in the original file's pixels: a 400x100 image
+// held as 100x25 and bright only in original columns 300-339.
+#include "SonifyEngine.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace sonify;
+
+int
+main()
+{
+    int failures = 0;
+    auto expect = [&](bool ok, const char *what)
+    {
+        if (!ok)
+        {
+            std::fprintf(stderr, "FAIL: %s\n", what);
+            ++failures;
+        }
+    };
+
+    constexpr int W = 100, H = 25;
+    std::vector<float> pixels(static_cast<std::size_t>(W) * H * 4, 0.0f);
+    for (int y = 0; y < H; ++y)
+        for (int x = 75; x < 85; ++x)
+            for (int c = 0; c < 4; ++c)
+                pixels[(static_cast<std::size_t>(y) * W + x) * 4 + c] = 1.0f;
+
+    SonifyEngine engine;
+    engine.set_raw_image(W, H, 4, W * 4, std::move(pixels));
+    engine.set_source_scale(4.0, 4.0);
+    expect(engine.source_width() == 400 && engine.source_height() == 100,
+           "source size is the original size");
+
+    engine.set_roi(300, 0, 40, 100);
+    const ROI &roi = engine.roi();
+    expect(roi.x == 300 && roi.w == 40 && roi.h == 100,
+           "the ROI is kept in original pixels");
+    expect(engine.pixel_brightness_at(310, 50) > 0.5f
+               && engine.pixel_brightness_at(200, 50) == 0.0f,
+           "pixel_brightness reads original pixels");
+
+    int min_x = 1 << 30, max_x = -1, width = 0;
+    float min_b = 1.0f;
+    engine.set_sonify_func([&](const SonifyContext &ctx, std::vector<float> &out)
+    {
+        min_x = std::min(min_x, ctx.x);
+        max_x = std::max(max_x, ctx.x);
+        min_b = std::min(min_b, ctx.brightness);
+        width = ctx.width;
+        out.assign(static_cast<std::size_t>(ctx.n_samples), 0.0f);
+    });
+    engine.sonify();
+    expect(min_x >= 300 && max_x < 340, "ctx.x stays inside the original ROI");
+    expect(width == 400, "ctx.width is the original width");
+    expect(min_b > 0.5f, "the scan reads only the bright columns");
+
+    return failures == 0 ? 0 : 1;
+}
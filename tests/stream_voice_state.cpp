@@ -0,0 +1,71 @@
+// Stateful voices carry their state across the frames of an open-ended
+// stream, where strip_index restarts with every frame: two frames rendered
+// open-ended must sound exactly as the same two frames numbered as one
+// sequence, with no re-attack at the boundary.
+#include "SonifyEngine.hpp"
+#include "Voices.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace sonify;
+
+static std::vector<float>
+render_two_frames(int frame_count)
+{
+    constexpr int W = 24, H = 8;
+    VoiceParams voice;
+    voice.ratio = 1.5f; // non-integer: the modulator phase is state
+    voice.decay = 0.05f;
+    voice.drone = 0.3f;
+
+    SonifyEngine engine;
+    engine.set_sonify_func(voices::make(voice), voices::thread_safe(voice));
+    engine.set_secs_per_unit(0.005f);
+
+    int frames = 0;
+    engine.sonify_frames(frame_count, [&](RawImage &img)
+    {
+        if (frames++ == 2)
+            return false;
+        img.width    = W;
+        img.height   = H;
+        img.channels = 4;
+        img.stride   = W * 4;
+        img.data.assign(static_cast<std::size_t>(W) * H * 4, 0.0f);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+                for (int c = 0; c < 3; ++c)
+                    img.data[(static_cast<std::size_t>(y) * W + x) * 4 + c]
+                        = (x * 7 % W) / static_cast<float>(W);
+        return true;
+    });
+    return engine.take_audio();
+}
+
+int
+main()
+{
+    int failures = 0;
+    auto expect = [&](bool ok, const char *what)
+    {
+        if (!ok)
+        {
+            std::fprintf(stderr, "FAIL: %s\n", what);
+            ++failures;
+        }
+    };
+
+    const std::vector<float> open_ended = render_two_frames(0);
+    const std::vector<float> counted    = render_two_frames(2);
+    expect(!open_ended.empty() && open_ended.size() == counted.size(),
+           "both renders hold two frames");
+
+    float max_diff = 0.0f;
+    for (std::size_t i = 0; i < open_ended.size() && i < counted.size(); ++i)
+        max_diff = std::max(max_diff, std::abs(open_ended[i] - counted[i]));
+    expect(max_diff < 1e-6f, "an open-ended stream keeps voice state across frames");
+
+    return failures == 0 ? 0 : 1;
+}